@@ -34,8 +34,7 @@
 #define INCLUDE_SMALLARGS_H_
 
 #include <stddef.h>
-#include <string.h>
-#include <stdlib.h>
+#include <stdint.h>
 
 #define SARG_VERSION "0.1.0"
 
@@ -47,12 +46,51 @@
 #define SARG_ERR_NOTFOUND     -5
 #define SARG_ERR_ALLOC        -6
 #define SARG_ERR_ABORT        -7
+#define SARG_ERR_AMBIGUOUS    -8
+#define SARG_ERR_RECURSION    -9
+#define SARG_ERR_MISSING     -10
+#define SARG_ERR_CONFLICT    -11
+#define SARG_ERR_RANGE       -12
+
+/* root was initialized with sarg_init_static and owns no memory */
+#define SARG_ROOT_STATIC      0x1
+/* root references its options and name, but owns its results */
+#define SARG_ROOT_SHARED      0x2
+/* root references the name index, defaults, rules, choices and ranges
+ * of another root, see sarg_init_copy */
+#define SARG_ROOT_BORROWED    0x4
+
+/* output formats of sarg_dump */
+#define SARG_DUMP_JSON        0
+#define SARG_DUMP_ARGS        1
+/* sarg_dump also writes options which did not appear */
+#define SARG_DUMP_ALL         0x1
+
+/* rules of sarg_add_rule */
+/* all given options have to appear */
+#define SARG_RULE_REQUIRED    0
+/* at most one of the given options may appear */
+#define SARG_RULE_EXCLUSIVE   1
+/* if the first option appears, all others have to appear as well */
+#define SARG_RULE_DEPENDS     2
+
+/* layers of sarg_layer_parse, higher layers take precedence over lower
+ * layers and all of them over the defaults */
+#define SARG_LAYER_SYSTEM     0
+#define SARG_LAYER_USER       1
+#define SARG_LAYER_ENV        2
+#define SARG_LAYER_ARGV       3
+#define SARG_MAX_LAYERS       8
+
+/* the file parsers allocate their buffers on the heap */
+#if defined(SARG_NO_MALLOC) && !defined(SARG_NO_FILE)
+#define SARG_NO_FILE
+#endif
 
 #define _SARG_UNUSED(e) ((void) e)
-#define _SARG_IS_SHORT_ARG(s) (s[0] == '-' && s[1] != '-')
-#define _SARG_IS_LONG_ARG(s) (s[0] == '-' && s[1] == '-')
 #define _SARG_IS_HEX_NUM(s) (s[0] == '0' && s[1] == 'x')
 #define _SARG_IS_OCT_NUM(s) (s[0] == '0' && strchr("1234567", s[1]) != NULL)
+#define _SARG_WORD_BITS ((int) (8 * sizeof(unsigned long)))
 
 
 #define sarg_foreach(root, it) \
@@ -66,6 +104,9 @@ typedef enum _sarg_opt_type {
     DOUBLE,
     BOOL,
     STRING,
+    ENUM,
+    SIZE,
+    DURATION,
     COUNT
 } sarg_opt_type;
 
@@ -78,11 +119,35 @@ typedef struct _sarg_result {
         double double_val;
         int bool_val;
         char *str_val;
+        // bytes of SIZE options
+        uint64_t size_val;
+        // nanoseconds of DURATION options
+        uint64_t duration_val;
     };
 } sarg_result;
 
 typedef int (*sarg_opt_cb)(const sarg_result *);
 
+/* finds an option by its exact name of the given length, see sarg_set_lookup */
+typedef int (*sarg_find_cb)(const char *, const int);
+
+/* heap functions of a root, each gets the context as first argument */
+typedef struct _sarg_allocator {
+    void *(*malloc_fn)(void *, size_t);
+    void *(*realloc_fn)(void *, void *, size_t);
+    void (*free_fn)(void *, void *);
+    void *ctx;
+} sarg_allocator;
+
+typedef struct _sarg_memory {
+    // bytes currently allocated, without the bookkeeping of each block
+    size_t bytes;
+    // blocks currently allocated
+    size_t allocs;
+    // calls to malloc and realloc so far
+    size_t total;
+} sarg_memory;
+
 typedef struct _sarg_opt {
     char *short_name;
     char *long_name;
@@ -91,14 +156,123 @@ typedef struct _sarg_opt {
     sarg_opt_cb callback;
 } sarg_opt;
 
+typedef struct _sarg_name_ref {
+    const char *name;
+    int idx;
+} _sarg_name_ref;
+
+typedef struct _sarg_str_slot {
+    char *data;
+    int cap;
+} _sarg_str_slot;
+
+typedef struct _sarg_rule {
+    int type;
+    // option which triggers a SARG_RULE_DEPENDS rule
+    int opt;
+} _sarg_rule;
+
+typedef struct _sarg_choices {
+    const char **names;
+    int len;
+    // perfect hash of the names into table, see sarg_set_choices
+    unsigned int seed;
+    int shift;
+    int *table;
+} _sarg_choices;
+
+typedef struct _sarg_range {
+    double min;
+    double max;
+    int set;
+} _sarg_range;
+
+typedef struct _sarg_layer {
+    // results of the options that appeared in the layer, followed by
+    // their option indices and string values in the same allocation
+    sarg_result *results;
+    int *opts;
+    int len;
+} _sarg_layer;
+
+typedef struct _sarg_cmd {
+    const char *name;
+    const char *help;
+    const sarg_opt *opts;
+} sarg_cmd;
+
 typedef struct _sarg_root {
     char *name;
     sarg_opt *opts;
     int opt_len;
     sarg_result *results;
     int res_len;
+    unsigned int flags;
+    char *str_buf;
+    int str_len;
+    int str_off;
+    char *help_buf;
+    int help_len;
+    int err_idx;
+    const sarg_cmd *cmds;
+    int cmd_len;
+    int cmd_idx;
+    int cmd_sel;
+    struct _sarg_root *cmd_root;
+    // sorted names for prefix matching and completion
+    _sarg_name_ref *names;
+    int short_len;
+    int long_len;
+    // open addressing table of all names for exact matching
+    unsigned int *hashes;
+    int *hash_lens;
+    int *hash_slots;
+    unsigned int hash_mask;
+    // strings of the options of sarg_init roots, help texts last
+    char *text;
+    // external exact name lookup, replaces the table above
+    sarg_find_cb find;
+    _sarg_str_slot *str_slots;
+    char *scratch;
+    size_t scratch_len;
+    // results sarg_reset restores, see sarg_set_default
+    sarg_result *defaults;
+    // rules and their option bitmasks, one mask of mask_len words each
+    _sarg_rule *rules;
+    unsigned long *rule_masks;
+    int rule_len;
+    int mask_len;
+    // bitmask of the options that appeared, only kept if there are rules
+    unsigned long *seen;
+    // option which violated a rule or -1
+    int err_opt;
+    // allowed values of ENUM options and ranges of numbers by option
+    _sarg_choices *choices;
+    _sarg_range *ranges;
+    // argv indices of the positional arguments of the last sarg_parse
+    int *pos;
+    int pos_len;
+    int pos_cap;
+    // sparse results by layer, see sarg_layer_parse
+    _sarg_layer *layers;
+    // heap of the root and what it holds, see sarg_set_allocator
+    sarg_allocator alloc;
+    sarg_memory mem;
 } sarg_root;
 
+typedef struct _sarg_storage {
+    sarg_result *results;
+    int res_len;
+    char *str_buf;
+    int str_len;
+    char *help_buf;
+    int help_len;
+    int *pos_buf;
+    int pos_len;
+} sarg_storage;
+
+typedef int (*sarg_write_cb)(void *, const char *, const size_t);
+
 typedef struct _sarg_iterator {
     sarg_root *root;
     sarg_result *result;
@@ -106,6 +280,289 @@ typedef struct _sarg_iterator {
     int idx;
 } sarg_iterator;
 
+/* one argument file of sarg_parse_files and the result of parsing it */
+typedef struct _sarg_file_job {
+    sarg_root *root;
+    const char *filename;
+    int ret;
+} sarg_file_job;
+
+/* ==========================================================
+ * Interface, see the definitions for the documentation
+ * ========================================================== */
+
+void _sarg_iterator_init(sarg_iterator *it, sarg_root *root);
+int _sarg_iterator_has_next(sarg_iterator *it);
+void _sarg_iterator_next(sarg_iterator *it);
+
+const char * sarg_strerror(const int errval);
+void sarg_destroy(sarg_root *root);
+void sarg_reset(sarg_root *root);
+int sarg_init_static(sarg_root *root, const sarg_opt *options,
+                     const char *name, const sarg_storage *storage);
+int sarg_complete(sarg_root *root, const char *prefix,
+                  const sarg_opt **matches, const int max_matches);
+int sarg_check(sarg_root *root);
+void sarg_set_lookup(sarg_root *root, sarg_find_cb find);
+int sarg_parse(sarg_root *root, const char **argv, const int argc);
+int sarg_positionals(sarg_root *root, const int **indices);
+sarg_memory sarg_memory_usage(sarg_root *root);
+void sarg_free_text(sarg_root *root, char *text);
+int sarg_parse_string(sarg_root *root, const char *cmdline);
+int sarg_parse_string_n(sarg_root *root, const char *cmdline, const size_t len);
+int sarg_parse_ini(sarg_root *root, const char *buf, const size_t len);
+int sarg_parse_json(sarg_root *root, const char *buf, const size_t len);
+int sarg_get(sarg_root *root, const char *name, sarg_result **res);
+int sarg_get_n(sarg_root *root, const char *name, const int len,
+               sarg_result **res);
+
+#ifndef SARG_NO_MALLOC
+void sarg_set_allocator(const sarg_allocator *alloc);
+int sarg_init(sarg_root *root, const sarg_opt *options, const char *name);
+int sarg_init_alloc(sarg_root *root, const sarg_opt *options,
+                    const char *name, const sarg_allocator *alloc);
+int sarg_init_shared(sarg_root *root, const sarg_opt *options, const int len,
+                     const char *name);
+int sarg_init_copy(sarg_root *root, const sarg_root *src);
+int sarg_set_commands(sarg_root *root, const sarg_cmd *cmds);
+const char *sarg_command(sarg_root *root);
+sarg_root *sarg_command_root(sarg_root *root);
+int sarg_set_default(sarg_root *root, const char *name, const char *value);
+int sarg_add_rule(sarg_root *root, const int type, const char **names);
+int sarg_set_choices(sarg_root *root, const char *name, const char **choices);
+int sarg_set_range(sarg_root *root, const char *name, const double min,
+                   const double max);
+int sarg_layer_parse(sarg_root *root, const int layer, const char **argv,
+                     const int argc);
+int sarg_layer_parse_string(sarg_root *root, const int layer,
+                            const char *cmdline);
+int sarg_layer_clear(sarg_root *root, const int layer);
+#ifndef SARG_NO_FILE
+int sarg_layer_parse_file(sarg_root *root, const int layer,
+                          const char *filename);
+#endif
+#endif
+
+#ifndef SARG_NO_PRINT
+int sarg_help_text(sarg_root *root, char **outbuf);
+int sarg_help_print(sarg_root *root);
+int sarg_dump(sarg_root *root, const int format, const unsigned int flags,
+              sarg_write_cb write, void *ctx);
+#ifndef SARG_NO_MALLOC
+int sarg_dump_text(sarg_root *root, const int format,
+                   const unsigned int flags, char **outbuf);
+int sarg_command_help_text(sarg_root *root, const char *cmd, char **outbuf);
+int sarg_command_help_print(sarg_root *root, const char *cmd);
+#endif
+#ifndef SARG_NO_FILE
+int sarg_dump_file(sarg_root *root, const int format,
+                   const unsigned int flags, const char *filename);
+#endif
+#endif
+
+#ifndef SARG_NO_FILE
+int sarg_parse_file(sarg_root *root, const char *filename);
+int sarg_parse_files(sarg_file_job *jobs, const int len, const int threads);
+int sarg_parse_ini_file(sarg_root *root, const char *filename);
+int sarg_parse_json_file(sarg_root *root, const char *filename);
+#endif
+
+#endif
+
+/* ==========================================================
+ * Implementation
+ * ========================================================== */
+
+#if defined(SARG_IMPLEMENTATION) && !defined(_SARG_IMPLEMENTATION_DONE)
+#define _SARG_IMPLEMENTATION_DONE
+
+/* helpers are local to the implementation, only sarg_* is exported */
+#ifdef __GNUC__
+#define _SARG_INTERNAL static __attribute__((unused))
+#else
+#define _SARG_INTERNAL static
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef SARG_NO_MALLOC
+
+_SARG_INTERNAL void *_sarg_std_malloc(void *ctx, size_t size)
+{
+    _SARG_UNUSED(ctx);
+    return malloc(size);
+}
+
+_SARG_INTERNAL void *_sarg_std_realloc(void *ctx, void *ptr, size_t size)
+{
+    _SARG_UNUSED(ctx);
+    return realloc(ptr, size);
+}
+
+_SARG_INTERNAL void _sarg_std_free(void *ctx, void *ptr)
+{
+    _SARG_UNUSED(ctx);
+    free(ptr);
+}
+
+/* allocator of the roots initialized next, see sarg_set_allocator */
+_SARG_INTERNAL sarg_allocator _sarg_alloc_default = {
+    _sarg_std_malloc, _sarg_std_realloc, _sarg_std_free, NULL
+};
+
+/* precedes each block to track the live bytes, aligned for any type */
+typedef union _sarg_mem_head {
+    size_t size;
+    long double align;
+} _sarg_mem_head;
+
+_SARG_INTERNAL void *_sarg_malloc(sarg_root *root, const size_t size)
+{
+    _sarg_mem_head *head;
+
+    if(size > (size_t) -1 - sizeof(_sarg_mem_head))
+        return NULL;
+
+    head = (_sarg_mem_head *) root->alloc.malloc_fn(root->alloc.ctx,
+                                                    sizeof(_sarg_mem_head) + size);
+    if(!head)
+        return NULL;
+
+    head->size = size;
+    root->mem.bytes += size;
+    ++root->mem.allocs;
+    ++root->mem.total;
+
+    return head + 1;
+}
+
+_SARG_INTERNAL void *_sarg_calloc(sarg_root *root, const size_t count, const size_t size)
+{
+    void *ptr;
+
+    if(size > 0 && count > (size_t) -1 / size)
+        return NULL;
+
+    ptr = _sarg_malloc(root, count * size);
+    if(ptr)
+        memset(ptr, 0, count * size);
+
+    return ptr;
+}
+
+_SARG_INTERNAL void *_sarg_realloc(sarg_root *root, void *ptr, const size_t size)
+{
+    _sarg_mem_head *head;
+    size_t old;
+
+    if(!ptr)
+        return _sarg_malloc(root, size);
+    if(size > (size_t) -1 - sizeof(_sarg_mem_head))
+        return NULL;
+
+    head = (_sarg_mem_head *) ptr - 1;
+    old = head->size;
+    head = (_sarg_mem_head *) root->alloc.realloc_fn(root->alloc.ctx, head,
+                                                     sizeof(_sarg_mem_head) + size);
+    if(!head)
+        return NULL;
+
+    head->size = size;
+    root->mem.bytes = root->mem.bytes - old + size;
+    ++root->mem.total;
+
+    return head + 1;
+}
+
+_SARG_INTERNAL void _sarg_free(sarg_root *root, void *ptr)
+{
+    _sarg_mem_head *head;
+
+    if(!ptr)
+        return;
+
+    head = (_sarg_mem_head *) ptr - 1;
+    root->mem.bytes -= head->size;
+    --root->mem.allocs;
+    root->alloc.free_fn(root->alloc.ctx, head);
+}
+
+/**
+ * @brief Sets the default allocator of the roots initialized afterwards.
+ *
+ * Each root keeps the allocator it was initialized with. To give a
+ * single root its own heap pass the allocator to sarg_init_alloc
+ * instead. The default is global and not synchronized, so set it
+ * before roots are initialized concurrently.
+ *
+ * Texts handed to the caller, e.g. by sarg_help_text, come from the
+ * allocator of their root as well and are released with
+ * sarg_free_text.
+ *
+ * @param alloc allocator, which is copied, or NULL to restore malloc,
+ *              realloc and free
+ */
+void sarg_set_allocator(const sarg_allocator *alloc)
+{
+    if(alloc) {
+        _sarg_alloc_default = *alloc;
+    } else {
+        _sarg_alloc_default.malloc_fn = _sarg_std_malloc;
+        _sarg_alloc_default.realloc_fn = _sarg_std_realloc;
+        _sarg_alloc_default.free_fn = _sarg_std_free;
+        _sarg_alloc_default.ctx = NULL;
+    }
+}
+
+#endif
+
+/**
+ * @brief Reports the heap memory held by the given root.
+ *
+ * Includes the memory of a cached subcommand root. Static roots do
+ * not allocate and report zero.
+ *
+ * @param root initialized root object
+ *
+ * @return live bytes and blocks and the number of allocations so far
+ */
+sarg_memory sarg_memory_usage(sarg_root *root)
+{
+    sarg_memory usage = root->mem;
+    sarg_memory sub;
+
+    if(root->cmd_root) {
+        sub = sarg_memory_usage(root->cmd_root);
+        usage.bytes += sub.bytes;
+        usage.allocs += sub.allocs;
+        usage.total += sub.total;
+    }
+
+    return usage;
+}
+
+/**
+ * @brief Releases a text returned by the given root.
+ *
+ * Texts of sarg_help_text, sarg_command_help_text and sarg_dump_text
+ * come from the allocator of the root they were requested from and
+ * have to be released with the same root. Does nothing for NULL and
+ * if SARG_NO_MALLOC is defined.
+ *
+ * @param root root object the text was requested from
+ * @param text text to release
+ */
+void sarg_free_text(sarg_root *root, char *text)
+{
+#ifdef SARG_NO_MALLOC
+    _SARG_UNUSED(root);
+    _SARG_UNUSED(text);
+#else
+    _sarg_free(root, text);
+#endif
+}
+
 void _sarg_iterator_init(sarg_iterator *it, sarg_root *root)
 {
     it->root = root;
@@ -137,30 +594,50 @@ void _sarg_iterator_next(sarg_iterator *it)
     }
 }
 
+static const char *_sarg_errstr[] = {
+    "success",
+    "system error, check errno",
+    "unknown error",
+    "invalid argument",
+    "failed to parse argument",
+    "unknown option",
+    "failed to allocate memory",
+    "aborted by callback",
+    "ambiguous option",
+    "response files nested too deeply",
+    "missing required option",
+    "conflicting options",
+    "value out of range"
+};
+
+#define _SARG_ERRSTR_LEN ((int) (sizeof(_sarg_errstr) / sizeof(_sarg_errstr[0])))
+
+/**
+ * @brief Returns a static message describing the given error code.
+ *
+ * @param errval SARG_ERR_* code
+ *
+ * @return message string, which must not be freed
+ */
 const char * sarg_strerror(const int errval)
 {
-    _SARG_UNUSED(errval);
-    return "small args error";
+    if(errval > 0 || -errval >= _SARG_ERRSTR_LEN)
+        return _sarg_errstr[-SARG_ERR_OTHER];
+    return _sarg_errstr[-errval];
 }
 
-void _sarg_result_destroy(sarg_result *res)
+_SARG_INTERNAL void _sarg_result_destroy(sarg_root *root, sarg_result *res)
 {
     if(res->type == STRING && res->str_val) {
-        free(res->str_val);
+#ifndef SARG_NO_MALLOC
+        _sarg_free(root, res->str_val);
+#else
+        _SARG_UNUSED(root);
+#endif
         res->str_val = NULL;
     }
 }
 
-void _sarg_opt_destroy(sarg_opt *opt)
-{
-    if(opt->short_name)
-        free(opt->short_name);
-    if(opt->long_name)
-        free(opt->long_name);
-    if(opt->help)
-        free(opt->help);
-}
-
 /**
  * @brief Destroys the given root and frees its memory.
  *
@@ -168,107 +645,402 @@ void _sarg_opt_destroy(sarg_opt *opt)
  */
 void sarg_destroy(sarg_root *root)
 {
+    // static roots only borrow their memory from the caller
+    if(root->flags & SARG_ROOT_STATIC) {
+        memset(root, 0, sizeof(sarg_root));
+        root->res_len = -1;
+        root->opt_len = -1;
+        return;
+    }
+
+#ifndef SARG_NO_MALLOC
     int i;
-    if(root->results) {
+
+    if(root->cmd_root) {
+        sarg_destroy(root->cmd_root);
+        _sarg_free(root, root->cmd_root);
+    }
+    root->cmd_root = NULL;
+    root->cmds = NULL;
+    root->cmd_len = 0;
+    root->cmd_idx = -1;
+    root->cmd_sel = 0;
+
+    // borrowed tables belong to the root they were copied from
+    if(root->flags & SARG_ROOT_BORROWED) {
+        root->names = NULL;
+        root->hashes = NULL;
+        root->defaults = NULL;
+        root->rules = NULL;
+        root->rule_masks = NULL;
+        root->choices = NULL;
+        root->ranges = NULL;
+    }
+
+    if(root->names)
+        _sarg_free(root, root->names);
+    root->names = NULL;
+    root->short_len = 0;
+    root->long_len = 0;
+
+    // lengths and slots share the allocation of the hashes
+    if(root->hashes)
+        _sarg_free(root, root->hashes);
+    root->hashes = NULL;
+    root->hash_lens = NULL;
+    root->hash_slots = NULL;
+    root->hash_mask = 0;
+
+    // string results point into their slots
+    if(root->str_slots) {
+        for(i = 0; i < root->opt_len; ++i) {
+            if(root->str_slots[i].data)
+                _sarg_free(root, root->str_slots[i].data);
+        }
+        _sarg_free(root, root->str_slots);
+    }
+    root->str_slots = NULL;
+
+    if(root->scratch)
+        _sarg_free(root, root->scratch);
+    root->scratch = NULL;
+    root->scratch_len = 0;
+
+    // default strings are owned by the defaults
+    if(root->defaults) {
         for(i = 0; i < root->res_len; ++i)
-            _sarg_result_destroy(&root->results[i]);
-        free(root->results);
+            _sarg_result_destroy(root, &root->defaults[i]);
+        _sarg_free(root, root->defaults);
     }
+    root->defaults = NULL;
+
+    if(root->rules)
+        _sarg_free(root, root->rules);
+    root->rules = NULL;
+    if(root->rule_masks)
+        _sarg_free(root, root->rule_masks);
+    root->rule_masks = NULL;
+    root->rule_len = 0;
+    root->mask_len = 0;
+    if(root->seen)
+        _sarg_free(root, root->seen);
+    root->seen = NULL;
+
+    if(root->choices) {
+        for(i = 0; i < root->opt_len; ++i) {
+            if(root->choices[i].table)
+                _sarg_free(root, root->choices[i].table);
+        }
+        _sarg_free(root, root->choices);
+    }
+    root->choices = NULL;
+    if(root->ranges)
+        _sarg_free(root, root->ranges);
+    root->ranges = NULL;
+    if(root->pos)
+        _sarg_free(root, root->pos);
+    root->pos = NULL;
+    root->pos_len = 0;
+    root->pos_cap = 0;
+
+    // strings of a layer share the allocation of its results
+    if(root->layers) {
+        for(i = 0; i < SARG_MAX_LAYERS; ++i) {
+            if(root->layers[i].results)
+                _sarg_free(root, root->layers[i].results);
+        }
+        _sarg_free(root, root->layers);
+    }
+    root->layers = NULL;
+
+    if(root->results)
+        _sarg_free(root, root->results);
 
     root->results = NULL;
     root->res_len = -1;
 
-    if(root->opts) {
-        for(i = 0; i < root->opt_len; ++i)
-            _sarg_opt_destroy(&root->opts[i]);
-        free(root->opts);
-    }
+    if(root->opts && !(root->flags & SARG_ROOT_SHARED))
+        _sarg_free(root, root->opts);
     root->opts = NULL;
     root->opt_len = -1;
 
-    if(root->name)
-        free(root->name);
+    // holds the name and all option strings of sarg_init roots
+    if(root->text)
+        _sarg_free(root, root->text);
+    root->text = NULL;
     root->name = NULL;
+    root->flags = 0;
+#endif
 }
 
-void _sarg_result_init(sarg_result *res, sarg_opt_type type)
+_SARG_INTERNAL void _sarg_result_init(sarg_result *res, sarg_opt_type type)
 {
     memset(res, 0, sizeof(sarg_result));
     res->type = type;
 }
 
-int _sarg_opt_init(sarg_opt *opt, const char *short_name, const char *long_name, const char *help, const sarg_opt_type type, sarg_opt_cb cb)
+/**
+ * @brief Resets all results of the given root to their defaults.
+ *
+ * Options without a default set by sarg_set_default are reset to zero.
+ * Afterwards the root can parse a new set of arguments as if it had
+ * just been initialized. The option table, the name index and the
+ * memory of string values are kept, so parsing similar arguments
+ * again does not allocate. A cached subcommand root is reset as well,
+ * but no subcommand counts as selected anymore.
+ *
+ * String values returned by a previous parse are invalidated.
+ *
+ * @param root root object that will be reset
+ */
+void sarg_reset(sarg_root *root)
 {
-    memset(opt, 0, sizeof(sarg_opt));
+    int i;
 
-    if(short_name) {
-        opt->short_name = (char *) malloc(strlen(short_name) + 1);
-       if(!opt->short_name)
-           return SARG_ERR_ALLOC;
-       strcpy(opt->short_name, short_name);
+    if(root->defaults) {
+        memcpy(root->results, root->defaults,
+               sizeof(sarg_result) * root->res_len);
+    } else {
+        for(i = 0; i < root->res_len; ++i)
+            _sarg_result_init(&root->results[i], root->results[i].type);
     }
+    if(root->seen)
+        memset(root->seen, 0, sizeof(unsigned long) * root->mask_len);
+
+    // static roots start over at the front of their string buffer
+    root->str_off = 0;
+    root->err_idx = -1;
+    root->err_opt = -1;
+    root->pos_len = 0;
+
+    if(root->cmd_root)
+        sarg_reset(root->cmd_root);
+    root->cmd_sel = 0;
+}
 
-    if(long_name) {
-        opt->long_name = (char *) malloc(strlen(long_name) + 1);
-        if(!opt->long_name)
-            return SARG_ERR_ALLOC;
-        strcpy(opt->long_name, long_name);
+_SARG_INTERNAL int _sarg_opt_len(const sarg_opt *options)
+{
+    int i;
+
+    for(i = 0; options[i].short_name || options[i].long_name; ++i);
+
+    return i;
+}
+
+/**
+ * FNV-1a hash of a name, which does not need to be NUL-terminated.
+ */
+_SARG_INTERNAL unsigned int _sarg_hash(const char *name, const int len)
+{
+    unsigned int hash = 2166136261u;
+    int i;
+
+    for(i = 0; i < len; ++i) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
     }
 
-    if(help) {
-        opt->help = (char *) malloc(strlen(help) + 1);
-        if(!opt->help)
-            return SARG_ERR_ALLOC;
-        strcpy(opt->help, help);
+    return hash;
+}
+
+/**
+ * Looks up an option by the exact short or long name in the hash table.
+ * Hashes and lengths are compared first, so the name of an option is
+ * only read on a likely match. Returns the option index or -1.
+ */
+_SARG_INTERNAL int _sarg_hash_find(const sarg_root *root, const char *name, const int len)
+{
+    unsigned int hash, pos;
+    const char *opt_name;
+    int slot;
+
+    hash = _sarg_hash(name, len);
+    pos = hash & root->hash_mask;
+    while((slot = root->hash_slots[pos]) >= 0) {
+        if(root->hashes[pos] == hash && root->hash_lens[pos] == len) {
+            opt_name = (slot & 1) ? root->opts[slot >> 1].long_name
+                                  : root->opts[slot >> 1].short_name;
+            if(memcmp(opt_name, name, len) == 0)
+                return slot >> 1;
+        }
+        pos = (pos + 1) & root->hash_mask;
     }
 
-    opt->callback = cb;
-    opt->type = type;
+    return -1;
+}
+
+#ifndef SARG_NO_MALLOC
+
+_SARG_INTERNAL void _sarg_hash_insert(sarg_root *root, const char *name, const int slot)
+{
+    unsigned int hash, pos;
+    int len;
+
+    len = strlen(name);
+    hash = _sarg_hash(name, len);
+    pos = hash & root->hash_mask;
+    while(root->hash_slots[pos] >= 0)
+        pos = (pos + 1) & root->hash_mask;
+
+    root->hashes[pos] = hash;
+    root->hash_lens[pos] = len;
+    root->hash_slots[pos] = slot;
+}
+
+/**
+ * Builds the hash table of all option names. Its size is a power of two
+ * of at least twice the number of names, so probe sequences stay short.
+ * Names are inserted in option order, thus equal names are found in
+ * option order as well.
+ */
+_SARG_INTERNAL int _sarg_hash_init(sarg_root *root, const int count)
+{
+    unsigned int cap;
+    int i;
+
+    for(cap = 8; cap < 2 * (unsigned int) count; cap *= 2);
+
+    root->hashes = (unsigned int *) _sarg_malloc(root, cap * (sizeof(unsigned int) + 2 * sizeof(int)));
+    if(!root->hashes)
+        return SARG_ERR_ALLOC;
+    root->hash_lens = (int *) &root->hashes[cap];
+    root->hash_slots = &root->hash_lens[cap];
+    root->hash_mask = cap - 1;
+    memset(root->hash_slots, -1, cap * sizeof(int));
+
+    // slots encode the option index and whether it is the long name
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].short_name)
+            _sarg_hash_insert(root, root->opts[i].short_name, 2 * i);
+        if(root->opts[i].long_name)
+            _sarg_hash_insert(root, root->opts[i].long_name, 2 * i + 1);
+    }
 
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_opt_duplicate(sarg_opt *dest, const sarg_opt *src)
+_SARG_INTERNAL int _sarg_name_ref_cmp(const void *lhs, const void *rhs)
 {
-    return _sarg_opt_init(dest, src->short_name, src->long_name, src->help, src->type, src->callback);
+    const _sarg_name_ref *l = (const _sarg_name_ref *) lhs;
+    const _sarg_name_ref *r = (const _sarg_name_ref *) rhs;
+    int cmp = strcmp(l->name, r->name);
+
+    return cmp != 0 ? cmp : l->idx - r->idx;
 }
 
-int _sarg_opt_len(const sarg_opt *options)
+/**
+ * Builds sorted arrays of the short and the long option names, which
+ * allow prefix lookups by binary search. Both arrays share one
+ * allocation, the long names follow the short names. Exact lookups go
+ * through the hash table built afterwards.
+ */
+_SARG_INTERNAL int _sarg_index_init(sarg_root *root)
 {
-    int i;
+    int i, short_len, long_len;
+    _sarg_name_ref *refs;
 
-    for(i = 0; options[i].short_name || options[i].long_name; ++i);
+    short_len = 0;
+    long_len = 0;
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].short_name)
+            ++short_len;
+        if(root->opts[i].long_name)
+            ++long_len;
+    }
 
-    return i;
+    if(short_len + long_len == 0)
+        return SARG_ERR_SUCCESS;
+
+    refs = (_sarg_name_ref *) _sarg_malloc(root, sizeof(_sarg_name_ref) * (short_len + long_len));
+    if(!refs)
+        return SARG_ERR_ALLOC;
+
+    short_len = 0;
+    long_len = 0;
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].short_name) {
+            refs[short_len].name = root->opts[i].short_name;
+            refs[short_len].idx = i;
+            ++short_len;
+        }
+    }
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].long_name) {
+            refs[short_len + long_len].name = root->opts[i].long_name;
+            refs[short_len + long_len].idx = i;
+            ++long_len;
+        }
+    }
+
+    qsort(refs, short_len, sizeof(_sarg_name_ref), _sarg_name_ref_cmp);
+    qsort(&refs[short_len], long_len, sizeof(_sarg_name_ref), _sarg_name_ref_cmp);
+
+    root->names = refs;
+    root->short_len = short_len;
+    root->long_len = long_len;
+
+    return _sarg_hash_init(root, short_len + long_len);
 }
 
 /**
- * @brief Initializes the root data structure with the given options.
+ * Copies str to *text and advances *text behind it.
+ */
+_SARG_INTERNAL char *_sarg_text_copy(char **text, const char *str)
+{
+    char *copy = *text;
+    size_t len;
+
+    if(!str)
+        return NULL;
+
+    len = strlen(str) + 1;
+    memcpy(copy, str, len);
+    *text += len;
+
+    return copy;
+}
+
+/**
+ * @brief Initializes a root like sarg_init, which allocates from the
+ *        given allocator.
+ *
+ * The root keeps its own copy of the allocator, so roots of different
+ * threads or subsystems can use different heaps without touching the
+ * global default of sarg_set_allocator. Subcommand roots use the
+ * allocator of their parent.
  *
  * @param root root data structure which will be used to parse arguments
  * @param options NULL-terminated array of allowed options
  * @param name name of the application
+ * @param alloc allocator of the root, which is copied, or NULL for the
+ *              one set with sarg_set_allocator
  *
  * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
  */
-int sarg_init(sarg_root *root, const sarg_opt *options, const char *name)
+int sarg_init_alloc(sarg_root *root, const sarg_opt *options,
+                    const char *name, const sarg_allocator *alloc)
 {
     int i, ret, len;
+    size_t name_len, help_len;
+    char *text, *help;
 
     memset(root, 0, sizeof(sarg_root));
+    root->alloc = alloc ? *alloc : _sarg_alloc_default;
 
     len = _sarg_opt_len(options);
 
     // init option array
-    root->opts = (sarg_opt *) malloc(sizeof(sarg_opt) * len);
+    root->opts = (sarg_opt *) _sarg_malloc(root, sizeof(sarg_opt) * len);
     if(!root->opts)
         return SARG_ERR_ALLOC;
 
     memset(root->opts, 0, sizeof(sarg_opt) * len);
     root->opt_len = len;
+    root->err_idx = -1;
+    root->err_opt = -1;
 
     // init result array
-    root->results = (sarg_result *) malloc(sizeof(sarg_result) * len);
+    root->results = (sarg_result *) _sarg_malloc(root, sizeof(sarg_result) * len);
     if(!root->results) {
         sarg_destroy(root);
         return SARG_ERR_ALLOC;
@@ -277,56 +1049,593 @@ int sarg_init(sarg_root *root, const sarg_opt *options, const char *name)
     memset(root->results, 0, sizeof(sarg_result) * len);
     root->res_len = len;
 
-    // init name
-    root->name = (char *) malloc(strlen(name) + 1);
-    if(!root->name) {
+    // copy all strings into one block, the names used for matching
+    // first and the help texts, which only sarg_help_text reads, last
+    name_len = strlen(name) + 1;
+    help_len = 0;
+    for(i = 0; i < len; ++i) {
+        if(options[i].short_name)
+            name_len += strlen(options[i].short_name) + 1;
+        if(options[i].long_name)
+            name_len += strlen(options[i].long_name) + 1;
+        if(options[i].help)
+            help_len += strlen(options[i].help) + 1;
+    }
+
+    root->text = (char *) _sarg_malloc(root, name_len + help_len);
+    if(!root->text) {
         sarg_destroy(root);
         return SARG_ERR_ALLOC;
     }
-    strcpy(root->name, name);
 
-    // duplicate the given options
-    for(i = 0; i < root->opt_len; ++i) {
-        ret = _sarg_opt_duplicate(&root->opts[i], &options[i]);
-        if(ret != SARG_ERR_SUCCESS) {
-            sarg_destroy(root);
-            return ret;
-        }
+    text = root->text;
+    help = &root->text[name_len];
+    root->name = _sarg_text_copy(&text, name);
+    for(i = 0; i < len; ++i) {
+        root->opts[i].short_name = _sarg_text_copy(&text, options[i].short_name);
+        root->opts[i].long_name = _sarg_text_copy(&text, options[i].long_name);
+        root->opts[i].help = _sarg_text_copy(&help, options[i].help);
+        root->opts[i].type = options[i].type;
+        root->opts[i].callback = options[i].callback;
     }
 
     // init results
     for(i = 0; i < root->res_len; ++i)
         _sarg_result_init(&root->results[i], root->opts[i].type);
 
+    ret = _sarg_index_init(root);
+    if(ret != SARG_ERR_SUCCESS) {
+        sarg_destroy(root);
+        return ret;
+    }
+
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_find_opt(sarg_root *root, const char *name)
+/**
+ * @brief Initializes the root data structure with the given options.
+ *
+ * @param root root data structure which will be used to parse arguments
+ * @param options NULL-terminated array of allowed options
+ * @param name name of the application
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_init(sarg_root *root, const sarg_opt *options, const char *name)
+{
+    return sarg_init_alloc(root, options, name, NULL);
+}
+
+/**
+ * @brief Initializes a root which references the given options and name.
+ *
+ * In contrast to sarg_init the options and the name are not copied,
+ * only the results and the name index are allocated. This way several
+ * roots can share one immutable option array, e.g. the schema of the
+ * C++ wrapper. The options and the name have to outlive the root.
+ *
+ * @param root root data structure which will be used to parse arguments
+ * @param options array of allowed options, which need not be terminated
+ * @param len number of options
+ * @param name name of the application
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_init_shared(sarg_root *root, const sarg_opt *options, const int len,
+                     const char *name)
 {
-    int i, is_short, is_long;
-    char *namep = (char *) name;
+    int i;
 
-    while(namep[0] == '-')
-        ++namep;
+    memset(root, 0, sizeof(sarg_root));
+    root->alloc = _sarg_alloc_default;
+
+    root->flags = SARG_ROOT_SHARED;
+    root->err_idx = -1;
+    root->err_opt = -1;
+    root->cmd_idx = -1;
+    root->name = (char *) name;
+    root->opts = (sarg_opt *) options;
+    root->opt_len = len;
 
-    for(i = 0; i < root->opt_len; ++i) {
-        is_short = root->opts[i].short_name
-                   && strcmp(namep, root->opts[i].short_name) == 0;
-        is_long = root->opts[i].long_name
-                  && strcmp(namep, root->opts[i].long_name) == 0;
-        if(is_short || is_long)
-            return i;
+    if(len > 0) {
+        root->results = (sarg_result *) _sarg_malloc(root, sizeof(sarg_result) * len);
+        if(!root->results) {
+            sarg_destroy(root);
+            return SARG_ERR_ALLOC;
+        }
     }
+    root->res_len = len;
 
-    return -1;
-}
+    for(i = 0; i < root->res_len; ++i)
+        _sarg_result_init(&root->results[i], root->opts[i].type);
 
-int _sarg_get_number_base(const char *arg)
-{
-    int len = strlen(arg);
-    int base = 10;
+    i = _sarg_index_init(root);
+    if(i != SARG_ERR_SUCCESS) {
+        sarg_destroy(root);
+        return i;
+    }
 
-    // define base for number conversion
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * @brief Initializes a root which shares everything but its results with src.
+ *
+ * The new root references the options, the name index, the defaults,
+ * the rules, the choices and the ranges of src, so nothing is hashed,
+ * sorted or converted again. Only the results and the bitmask of the
+ * rules are allocated. Parsing with either root does not affect the
+ * other one. src must not be changed anymore and has to outlive the
+ * new root. sarg_set_default, sarg_add_rule, sarg_set_choices and
+ * sarg_set_range fail with SARG_ERR_INVALARG on the new root.
+ *
+ * @param root root data structure which will be used to parse arguments
+ * @param src initialized root, which must not be static
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_init_copy(sarg_root *root, const sarg_root *src)
+{
+    int i;
+
+    if(src->flags & SARG_ROOT_STATIC)
+        return SARG_ERR_INVALARG;
+
+    memset(root, 0, sizeof(sarg_root));
+    root->alloc = src->alloc;
+    root->flags = SARG_ROOT_SHARED | SARG_ROOT_BORROWED;
+    root->err_idx = -1;
+    root->err_opt = -1;
+    root->name = src->name;
+    root->opts = src->opts;
+    root->opt_len = src->opt_len;
+    root->cmds = src->cmds;
+    root->cmd_len = src->cmd_len;
+    root->cmd_idx = -1;
+    root->names = src->names;
+    root->short_len = src->short_len;
+    root->long_len = src->long_len;
+    root->hashes = src->hashes;
+    root->hash_lens = src->hash_lens;
+    root->hash_slots = src->hash_slots;
+    root->hash_mask = src->hash_mask;
+    root->find = src->find;
+    root->defaults = src->defaults;
+    root->rules = src->rules;
+    root->rule_masks = src->rule_masks;
+    root->rule_len = src->rule_len;
+    root->mask_len = src->mask_len;
+    root->choices = src->choices;
+    root->ranges = src->ranges;
+
+    if(src->opt_len > 0) {
+        root->results = (sarg_result *) _sarg_malloc(root, sizeof(sarg_result) * src->opt_len);
+        if(!root->results) {
+            sarg_destroy(root);
+            return SARG_ERR_ALLOC;
+        }
+    }
+    root->res_len = src->opt_len;
+    for(i = 0; i < root->res_len; ++i)
+        _sarg_result_init(&root->results[i], root->opts[i].type);
+
+    if(src->seen) {
+        root->seen = (unsigned long *) _sarg_calloc(root, src->mask_len, sizeof(unsigned long));
+        if(!root->seen) {
+            sarg_destroy(root);
+            return SARG_ERR_ALLOC;
+        }
+    }
+
+    sarg_reset(root);
+
+    return SARG_ERR_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Initializes the root data structure without allocating memory.
+ *
+ * The root only references the given options and name, so both have
+ * to outlive the root. All parsing results, string values and help
+ * text are stored in the memory provided by storage. If any of these
+ * buffers is exhausted the respective call returns SARG_ERR_ALLOC.
+ *
+ * The string buffer and the help buffer are optional, if the options
+ * contain no STRING option or no help text is needed.
+ *
+ * sarg_destroy has to be called nonetheless, but does not free any
+ * memory.
+ *
+ * @param root root data structure which will be used to parse arguments
+ * @param options NULL-terminated array of allowed options
+ * @param name name of the application
+ * @param storage caller provided memory for results, strings and help text
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_init_static(sarg_root *root, const sarg_opt *options,
+                     const char *name, const sarg_storage *storage)
+{
+    int i, len;
+
+    memset(root, 0, sizeof(sarg_root));
+
+    len = _sarg_opt_len(options);
+    if(storage->res_len < len)
+        return SARG_ERR_ALLOC;
+
+#ifndef SARG_NO_MALLOC
+    // only for temporary buffers, e.g. of sarg_parse_file
+    root->alloc = _sarg_alloc_default;
+#endif
+    root->flags = SARG_ROOT_STATIC;
+    root->err_idx = -1;
+    root->err_opt = -1;
+    root->name = (char *) name;
+    root->opts = (sarg_opt *) options;
+    root->opt_len = len;
+    root->results = storage->results;
+    root->res_len = len;
+    root->str_buf = storage->str_buf;
+    root->str_len = storage->str_buf ? storage->str_len : 0;
+    root->str_off = 0;
+    root->help_buf = storage->help_buf;
+    root->help_len = storage->help_buf ? storage->help_len : 0;
+    root->pos = storage->pos_buf;
+    root->pos_cap = storage->pos_buf ? storage->pos_len : 0;
+
+    for(i = 0; i < root->res_len; ++i)
+        _sarg_result_init(&root->results[i], root->opts[i].type);
+
+    return SARG_ERR_SUCCESS;
+}
+
+#ifndef SARG_NO_MALLOC
+
+/**
+ * @brief Registers subcommands with the given root.
+ *
+ * The first argument which is not an option or an option value
+ * selects the subcommand. All following arguments are parsed with the
+ * options of this subcommand. The option array of a subcommand is only
+ * initialized when the subcommand is actually invoked, so defining a
+ * large number of subcommands costs nothing up front.
+ *
+ * The command array is referenced and has to outlive the root. It is
+ * terminated by an element whose name is NULL.
+ *
+ * @param root initialized root object
+ * @param cmds NULL-terminated array of subcommands
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_set_commands(sarg_root *root, const sarg_cmd *cmds)
+{
+    int len;
+
+    if(root->flags & SARG_ROOT_STATIC)
+        return SARG_ERR_INVALARG;
+
+    for(len = 0; cmds[len].name; ++len);
+
+    root->cmds = cmds;
+    root->cmd_len = len;
+    root->cmd_idx = -1;
+
+    return SARG_ERR_SUCCESS;
+}
+
+_SARG_INTERNAL int _sarg_find_cmd_n(sarg_root *root, const char *name, const int len)
+{
+    int i;
+
+    for(i = 0; i < root->cmd_len; ++i) {
+        if((int) strlen(root->cmds[i].name) == len
+           && strncmp(name, root->cmds[i].name, len) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+_SARG_INTERNAL int _sarg_find_cmd(sarg_root *root, const char *name)
+{
+    return _sarg_find_cmd_n(root, name, strlen(name));
+}
+
+/**
+ * Initializes a root for the given subcommand. Its name consists of
+ * the application name and the command name for the usage line.
+ */
+_SARG_INTERNAL int _sarg_cmd_init(sarg_root *root, const int cmd_idx, sarg_root *cmd_root)
+{
+    const sarg_cmd *cmd = &root->cmds[cmd_idx];
+    static const sarg_opt no_opts[] = {{NULL, NULL, NULL, INT, NULL}};
+    char *name;
+    int ret, len;
+
+    len = strlen(root->name);
+    name = (char *) _sarg_malloc(root, len + strlen(cmd->name) + 2);
+    if(!name)
+        return SARG_ERR_ALLOC;
+    memcpy(name, root->name, len);
+    name[len] = ' ';
+    strcpy(&name[len + 1], cmd->name);
+
+    ret = sarg_init_alloc(cmd_root, cmd->opts ? cmd->opts : no_opts, name,
+                          &root->alloc);
+    _sarg_free(root, name);
+
+    return ret;
+}
+
+/**
+ * Selects the given subcommand and initializes its root if it was not
+ * selected before.
+ */
+_SARG_INTERNAL int _sarg_cmd_select(sarg_root *root, const int cmd_idx)
+{
+    int ret;
+
+    if(root->cmd_root && root->cmd_idx == cmd_idx) {
+        root->cmd_sel = 1;
+        return SARG_ERR_SUCCESS;
+    }
+
+    root->cmd_sel = 0;
+    if(root->cmd_root) {
+        sarg_destroy(root->cmd_root);
+    } else {
+        root->cmd_root = (sarg_root *) _sarg_malloc(root, sizeof(sarg_root));
+        if(!root->cmd_root)
+            return SARG_ERR_ALLOC;
+    }
+
+    ret = _sarg_cmd_init(root, cmd_idx, root->cmd_root);
+    if(ret != SARG_ERR_SUCCESS) {
+        _sarg_free(root, root->cmd_root);
+        root->cmd_root = NULL;
+        root->cmd_idx = -1;
+        return ret;
+    }
+    root->cmd_idx = cmd_idx;
+    root->cmd_sel = 1;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * @brief Returns the name of the subcommand selected by sarg_parse.
+ *
+ * @param root root object that was used to parse arguments
+ *
+ * @return name of the subcommand or NULL if none was selected
+ */
+const char *sarg_command(sarg_root *root)
+{
+    if(!root->cmd_root || !root->cmd_sel)
+        return NULL;
+    return root->cmds[root->cmd_idx].name;
+}
+
+/**
+ * @brief Returns the root holding the results of the selected subcommand.
+ *
+ * Use sarg_get on the returned root to access the options of the
+ * subcommand. The returned root is owned by root.
+ *
+ * @param root root object that was used to parse arguments
+ *
+ * @return root of the subcommand or NULL if none was selected
+ */
+sarg_root *sarg_command_root(sarg_root *root)
+{
+    return root->cmd_sel ? root->cmd_root : NULL;
+}
+
+#endif
+
+/**
+ * Compares a NUL-terminated name with a name of the given length. The
+ * key may contain NUL bytes, which sort before any other character.
+ */
+_SARG_INTERNAL int _sarg_name_cmp(const char *name, const char *key, const int keylen)
+{
+    int i;
+
+    for(i = 0; i < keylen; ++i) {
+        if(name[i] == '\0')
+            return key[i] == '\0' ? -1 : -(unsigned char) key[i];
+        if(name[i] != key[i])
+            return (unsigned char) name[i] - (unsigned char) key[i];
+    }
+
+    return name[keylen] != '\0';
+}
+
+/**
+ * Returns the position of the first name in the sorted refs, which is
+ * not less than the given key.
+ */
+_SARG_INTERNAL int _sarg_index_lower(const _sarg_name_ref *refs, const int len,
+                                     const char *key, const int keylen)
+{
+    int lo = 0, hi = len, mid;
+
+    while(lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if(_sarg_name_cmp(refs[mid].name, key, keylen) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/**
+ * Finds the option whose short or long name equals the given name of
+ * length len. If several options match, the first one is returned.
+ */
+_SARG_INTERNAL int _sarg_find_opt_n(sarg_root *root, const char *name, const int len)
+{
+    int i;
+
+    if(root->find)
+        return root->find(name, len);
+    if(root->hash_slots)
+        return _sarg_hash_find(root, name, len);
+
+    // roots without index are searched linearly
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].short_name
+           && _sarg_name_cmp(root->opts[i].short_name, name, len) == 0)
+            return i;
+        if(root->opts[i].long_name
+           && _sarg_name_cmp(root->opts[i].long_name, name, len) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+_SARG_INTERNAL int _sarg_find_opt(sarg_root *root, const char *name)
+{
+    while(name[0] == '-')
+        ++name;
+
+    return _sarg_find_opt_n(root, name, strlen(name));
+}
+
+/**
+ * @brief Replaces the exact name lookup of the given root.
+ *
+ * find receives a name without dashes, which is not NUL-terminated,
+ * and returns the index of the option with this short or long name or
+ * -1. This way a lookup generated at build time, e.g. by sarg_gen,
+ * serves static roots without any table built at runtime. Abbreviated
+ * long names are still matched by the root itself.
+ *
+ * @param root initialized root object
+ * @param find lookup function or NULL to restore the default lookup
+ */
+void sarg_set_lookup(sarg_root *root, sarg_find_cb find)
+{
+    root->find = find;
+}
+
+/**
+ * Finds the option whose long name starts with the given prefix.
+ * Returns SARG_ERR_NOTFOUND if no option and SARG_ERR_AMBIGUOUS if
+ * more than one option matches.
+ */
+_SARG_INTERNAL int _sarg_find_long_prefix(sarg_root *root, const char *prefix, const int len)
+{
+    int i, pos, found;
+
+    if(root->names) {
+        const _sarg_name_ref *refs = &root->names[root->short_len];
+
+        pos = _sarg_index_lower(refs, root->long_len, prefix, len);
+        if(pos >= root->long_len || strncmp(refs[pos].name, prefix, len) != 0)
+            return SARG_ERR_NOTFOUND;
+        if(pos + 1 < root->long_len
+           && strncmp(refs[pos + 1].name, prefix, len) == 0)
+            return SARG_ERR_AMBIGUOUS;
+        return refs[pos].idx;
+    }
+
+    found = SARG_ERR_NOTFOUND;
+    for(i = 0; i < root->opt_len; ++i) {
+        if(root->opts[i].long_name
+           && strncmp(root->opts[i].long_name, prefix, len) == 0) {
+            if(found >= 0)
+                return SARG_ERR_AMBIGUOUS;
+            found = i;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Adds all options of the sorted refs, whose name starts with prefix.
+ */
+_SARG_INTERNAL int _sarg_complete_refs(sarg_root *root, const _sarg_name_ref *refs,
+                                       const int len, const char *prefix, const int prefix_len,
+                                       const sarg_opt **matches, const int max_matches,
+                                       int count)
+{
+    int pos;
+
+    pos = _sarg_index_lower(refs, len, prefix, prefix_len);
+    for(; pos < len && strncmp(refs[pos].name, prefix, prefix_len) == 0; ++pos) {
+        if(count < max_matches)
+            matches[count] = &root->opts[refs[pos].idx];
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Finds all options which start with the given prefix.
+ *
+ * A prefix with a single leading dash is matched against short names,
+ * otherwise against long names. The matches are sorted by name.
+ *
+ * At most max_matches options are written to matches, but the total
+ * number of matches is returned. Roots initialized with
+ * sarg_init_static are searched linearly and return their matches in
+ * definition order.
+ *
+ * @param root initialized root object
+ * @param prefix prefix of the options to complete, e.g. "--co"
+ * @param matches array which receives the matching options
+ * @param max_matches size of the matches array
+ *
+ * @return number of matching options
+ */
+int sarg_complete(sarg_root *root, const char *prefix,
+                  const sarg_opt **matches, const int max_matches)
+{
+    int i, is_short, len, count;
+    const char *name;
+
+    is_short = prefix[0] == '-' && prefix[1] != '-';
+    while(prefix[0] == '-')
+        ++prefix;
+    len = strlen(prefix);
+
+    if(root->names) {
+        if(is_short)
+            return _sarg_complete_refs(root, root->names, root->short_len,
+                                       prefix, len, matches, max_matches, 0);
+        return _sarg_complete_refs(root, &root->names[root->short_len],
+                                   root->long_len, prefix, len,
+                                   matches, max_matches, 0);
+    }
+
+    count = 0;
+    for(i = 0; i < root->opt_len; ++i) {
+        name = is_short ? root->opts[i].short_name : root->opts[i].long_name;
+        if(name && strncmp(name, prefix, len) == 0) {
+            if(count < max_matches)
+                matches[count] = &root->opts[i];
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+_SARG_INTERNAL int _sarg_get_number_base(const char *arg)
+{
+    int len = strlen(arg);
+    int base = 10;
+
+    // define base for number conversion
     if(len > 2) {
         if(_SARG_IS_OCT_NUM(arg))
             base = 8;
@@ -337,7 +1646,7 @@ int _sarg_get_number_base(const char *arg)
     return base;
 }
 
-int _sarg_parse_int(const char *arg, sarg_result *res)
+_SARG_INTERNAL int _sarg_parse_int(const char *arg, sarg_result *res)
 {
     int base;
     char *endptr;
@@ -351,7 +1660,7 @@ int _sarg_parse_int(const char *arg, sarg_result *res)
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_parse_uint(const char *arg, sarg_result *res)
+_SARG_INTERNAL int _sarg_parse_uint(const char *arg, sarg_result *res)
 {
     int base;
     char *endptr;
@@ -365,7 +1674,7 @@ int _sarg_parse_uint(const char *arg, sarg_result *res)
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_parse_double(const char *arg, sarg_result *res)
+_SARG_INTERNAL int _sarg_parse_double(const char *arg, sarg_result *res)
 {
     char *endptr;
 
@@ -376,7 +1685,7 @@ int _sarg_parse_double(const char *arg, sarg_result *res)
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_parse_bool(const char *arg, sarg_result *res)
+_SARG_INTERNAL int _sarg_parse_bool(const char *arg, sarg_result *res)
 {
     _SARG_UNUSED(arg);
     res->bool_val = !res->bool_val;
@@ -384,464 +1693,3589 @@ int _sarg_parse_bool(const char *arg, sarg_result *res)
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_parse_str(const char *arg, sarg_result *res)
+/**
+ * Converts a boolean word as found in configuration files.
+ */
+_SARG_INTERNAL int _sarg_parse_bool_word(const char *arg, const int len, int *val)
 {
-    if(res->str_val)
-        free(res->str_val);
-
-    res->str_val = (char*) malloc(strlen(arg) + 1);
-    if(!res->str_val)
-        return SARG_ERR_ALLOC;
+    static const char *words[8] = {
+        "true", "yes", "on", "1", "false", "no", "off", "0"
+    };
+    int i;
 
-    strcpy(res->str_val, arg);
+    for(i = 0; i < 8; ++i) {
+        if(_sarg_name_cmp(words[i], arg, len) == 0) {
+            *val = i < 4;
+            return SARG_ERR_SUCCESS;
+        }
+    }
 
-    return SARG_ERR_SUCCESS;
+    return SARG_ERR_PARSE;
 }
 
-typedef int (*_sarg_parse_func)(const char *, sarg_result *);
-static _sarg_parse_func _sarg_parse_funcs[COUNT] = {
-    _sarg_parse_int,
-    _sarg_parse_uint,
-    _sarg_parse_double,
-    _sarg_parse_bool,
-    _sarg_parse_str,
-};
-
 /**
- * @brief Parses the given arguments with the given root object.
- *
- * The root object has to be initialized with sarg_init before
- * being passed to this function.
- *
- * If specified this function will call callback functions on the
- * appearance of the corresponding options.
- *
- * @param root root object which should be used to parse arguments
- * @param argv array of arguments to be parsed
- * @param argc number of elements in argv
- *
- * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ * Reads a decimal number with an optional fraction and advances *str
+ * behind it. The integral part is exact, the fraction is kept apart.
  */
-int sarg_parse(sarg_root *root, const char **argv, const int argc)
+_SARG_INTERNAL int _sarg_parse_decimal(const char **str, uint64_t *whole, double *frac)
 {
-    int i, arg_idx, len, ret;
+    const char *s = *str;
+    double scale;
+    int digits;
+
+    *whole = 0;
+    *frac = 0.0;
+    for(digits = 0; *s >= '0' && *s <= '9'; ++s, ++digits) {
+        if(*whole > (UINT64_MAX - (*s - '0')) / 10)
+            return SARG_ERR_RANGE;
+        *whole = *whole * 10 + (*s - '0');
+    }
 
-    for(i = 1; i < argc; ++i) {
-        // argument has to have at least 2 chars
-        len = strlen(argv[i]);
-        if(len < 2)
-            return SARG_ERR_PARSE;
+    if(*s == '.') {
+        scale = 0.1;
+        for(++s; *s >= '0' && *s <= '9'; ++s, ++digits) {
+            *frac += (*s - '0') * scale;
+            scale *= 0.1;
+        }
+    }
 
-        if(_SARG_IS_SHORT_ARG(argv[i]) || _SARG_IS_LONG_ARG(argv[i])) {
-            // find option
-            arg_idx = _sarg_find_opt(root, argv[i]);
-            if(arg_idx < 0)
-                return SARG_ERR_NOTFOUND;
+    if(digits == 0)
+        return SARG_ERR_PARSE;
+    *str = s;
 
-            if(root->opts[arg_idx].type != BOOL) {
-                ++i;
-                if(i >= argc)
-                    return SARG_ERR_PARSE;
-            }
+    return SARG_ERR_SUCCESS;
+}
 
-            ret = _sarg_parse_funcs[root->opts[arg_idx].type](
-                      argv[i], &root->results[arg_idx]);
+/**
+ * Multiplies a number read by _sarg_parse_decimal with unit and adds
+ * it to *val, failing on overflow.
+ */
+_SARG_INTERNAL int _sarg_add_scaled(uint64_t whole, double frac, uint64_t unit, uint64_t *val)
+{
+    uint64_t part;
+
+    if(whole > UINT64_MAX / unit)
+        return SARG_ERR_RANGE;
+    // the fraction adds less than one unit
+    part = whole * unit + (uint64_t) (frac * (double) unit);
+    if(part < whole * unit || *val > UINT64_MAX - part)
+        return SARG_ERR_RANGE;
+    *val += part;
+
+    return SARG_ERR_SUCCESS;
+}
+
+// a whole number of bytes has at most 60 fraction digits, see 1024^6
+#define _SARG_MAX_FRAC_DIGITS 64
+
+/**
+ * Multiplies the fraction digits of a size power times with base and
+ * stores the whole part of the product in *val. The digits are scaled
+ * exactly, so that a fraction which does not give a whole number of
+ * bytes fails with SARG_ERR_PARSE.
+ */
+_SARG_INTERNAL int _sarg_scale_fraction(const char *frac, int len, const int base,
+                                        const int power, uint64_t *val)
+{
+    unsigned char digits[_SARG_MAX_FRAC_DIGITS];
+    unsigned int carry;
+    int i, p;
+
+    // trailing zeros do not change the value
+    while(len > 0 && frac[len - 1] == '0')
+        --len;
+    if(len > _SARG_MAX_FRAC_DIGITS)
+        return SARG_ERR_PARSE;
+    for(i = 0; i < len; ++i)
+        digits[i] = (unsigned char) (frac[i] - '0');
+
+    *val = 0;
+    for(p = 0; p < power; ++p) {
+        carry = 0;
+        for(i = len - 1; i >= 0; --i) {
+            carry += digits[i] * base;
+            digits[i] = carry % 10;
+            carry /= 10;
+        }
+        // stays below one unit, so it cannot overflow
+        *val = *val * base + carry;
+    }
+
+    for(i = 0; i < len; ++i) {
+        if(digits[i] != 0)
+            return SARG_ERR_PARSE;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Converts a size like "512", "1.5M" or "4GiB" to bytes. k, M, G, T, P
+ * and E are powers of 1000, Ki, Mi, Gi, Ti, Pi and Ei powers of 1024.
+ * A trailing B is optional. A fraction has to give a whole number of
+ * bytes, so "1.5" or "1.0001k" fail with SARG_ERR_PARSE. Values which
+ * exceed 64 bits fail with SARG_ERR_RANGE.
+ */
+_SARG_INTERNAL int _sarg_parse_size(const char *arg, sarg_result *res)
+{
+    static const char prefixes[] = "kMGTPE";
+    const char *start, *prefix, *frac;
+    uint64_t whole, unit, part;
+    double unused;
+    int len, frac_len, base, power, ret;
+
+    start = arg;
+    ret = _sarg_parse_decimal(&arg, &whole, &unused);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    // the digits of the fraction end where the unit starts
+    for(frac = arg; frac > start && frac[-1] >= '0' && frac[-1] <= '9'; --frac)
+        ;
+    frac_len = frac > start && frac[-1] == '.' ? (int) (arg - frac) : 0;
+
+    len = strlen(arg);
+    if(len > 0 && arg[len - 1] == 'B')
+        --len;
+
+    base = 1000;
+    power = 0;
+    if(len > 0) {
+        prefix = strchr(prefixes, arg[0] == 'K' ? 'k' : arg[0]);
+        if(!prefix || len > 2 || (len == 2 && arg[1] != 'i'))
+            return SARG_ERR_PARSE;
+        base = len == 2 ? 1024 : 1000;
+        power = prefix - prefixes + 1;
+    }
+
+    ret = _sarg_scale_fraction(frac, frac_len, base, power, &part);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    for(unit = 1; power > 0; --power)
+        unit *= base;
+    if(whole > UINT64_MAX / unit || whole * unit > UINT64_MAX - part)
+        return SARG_ERR_RANGE;
+    res->size_val = whole * unit + part;
+
+    return SARG_ERR_SUCCESS;
+}
+
+typedef struct _sarg_unit {
+    const char *name;
+    uint64_t factor;
+} _sarg_unit;
+
+static const _sarg_unit _sarg_duration_units[] = {
+    {"ns", 1ULL},
+    {"us", 1000ULL},
+    {"\xc2\xb5s", 1000ULL},
+    {"ms", 1000000ULL},
+    {"s", 1000000000ULL},
+    {"m", 60000000000ULL},
+    {"h", 3600000000000ULL},
+    {"d", 86400000000000ULL}
+};
+
+#define _SARG_DURATION_UNIT_LEN \
+    ((int) (sizeof(_sarg_duration_units) / sizeof(_sarg_duration_units[0])))
+
+/**
+ * Converts a duration like "250ms", "1.5s" or "1h30m" to nanoseconds.
+ * Every number needs one of the units ns, us, ms, s, m, h or d, except
+ * for a plain "0". Values which exceed 64 bits fail with SARG_ERR_RANGE.
+ */
+_SARG_INTERNAL int _sarg_parse_duration(const char *arg, sarg_result *res)
+{
+    const char *unit;
+    uint64_t whole;
+    double frac;
+    int i, ret;
+
+    res->duration_val = 0;
+    if(strcmp(arg, "0") == 0)
+        return SARG_ERR_SUCCESS;
+    if(arg[0] == '\0')
+        return SARG_ERR_PARSE;
+
+    while(arg[0] != '\0') {
+        ret = _sarg_parse_decimal(&arg, &whole, &frac);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+
+        // the unit reaches up to the next number
+        for(unit = arg; *arg != '\0' && *arg != '.' && (*arg < '0' || *arg > '9'); ++arg);
+        for(i = 0; i < _SARG_DURATION_UNIT_LEN; ++i) {
+            if(_sarg_name_cmp(_sarg_duration_units[i].name, unit, arg - unit) == 0)
+                break;
+        }
+        if(i == _SARG_DURATION_UNIT_LEN)
+            return SARG_ERR_PARSE;
+
+        ret = _sarg_add_scaled(whole, frac, _sarg_duration_units[i].factor,
+                               &res->duration_val);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+#ifndef SARG_NO_MALLOC
+_SARG_INTERNAL int _sarg_parse_str_n(sarg_root *root, const char *arg, const int len,
+                                     sarg_result *res)
+{
+    if(res->str_val)
+        _sarg_free(root, res->str_val);
+
+    res->str_val = (char*) _sarg_malloc(root, len + 1);
+    if(!res->str_val)
+        return SARG_ERR_ALLOC;
+
+    memcpy(res->str_val, arg, len);
+    res->str_val[len] = '\0';
+
+    return SARG_ERR_SUCCESS;
+}
+
+_SARG_INTERNAL int _sarg_parse_str(sarg_root *root, const char *arg, sarg_result *res)
+{
+    return _sarg_parse_str_n(root, arg, strlen(arg), res);
+}
+
+/**
+ * Stores a string value in the slot of the given option. Slots only
+ * grow and survive sarg_reset, so parsing values of similar length
+ * again does not allocate.
+ */
+_SARG_INTERNAL int _sarg_parse_str_slot(sarg_root *root, const int idx, const char *arg,
+                                        const int len, sarg_result *res)
+{
+    _sarg_str_slot *slot;
+    char *data;
+
+    if(!root->str_slots) {
+        root->str_slots = (_sarg_str_slot *) _sarg_calloc(root, root->opt_len,
+                                                    sizeof(_sarg_str_slot));
+        if(!root->str_slots)
+            return SARG_ERR_ALLOC;
+    }
+
+    slot = &root->str_slots[idx];
+    if(slot->cap < len + 1) {
+        data = (char *) _sarg_realloc(root, slot->data, len + 1);
+        if(!data)
+            return SARG_ERR_ALLOC;
+        slot->data = data;
+        slot->cap = len + 1;
+    }
+
+    memcpy(slot->data, arg, len);
+    slot->data[len] = '\0';
+    res->str_val = slot->data;
+
+    return SARG_ERR_SUCCESS;
+}
+#endif
+
+/**
+ * Stores a string value in the string buffer of a static root.
+ * The previous value is overwritten in place if the new one fits,
+ * so repeatedly setting an option does not exhaust the buffer.
+ */
+_SARG_INTERNAL int _sarg_parse_str_static(sarg_root *root, const char *arg, const int len,
+                                          sarg_result *res)
+{
+    if(res->str_val && (int) strlen(res->str_val) >= len) {
+        memcpy(res->str_val, arg, len);
+        res->str_val[len] = '\0';
+        return SARG_ERR_SUCCESS;
+    }
+
+    if(root->str_len - root->str_off < len + 1)
+        return SARG_ERR_ALLOC;
+
+    // the value may already sit there, see _sarg_scratch
+    res->str_val = &root->str_buf[root->str_off];
+    memmove(res->str_val, arg, len);
+    res->str_val[len] = '\0';
+    root->str_off += len + 1;
+
+    return SARG_ERR_SUCCESS;
+}
+
+typedef int (*_sarg_parse_func)(const char *, sarg_result *);
+static _sarg_parse_func _sarg_parse_funcs[COUNT] = {
+    _sarg_parse_int,
+    _sarg_parse_uint,
+    _sarg_parse_double,
+    _sarg_parse_bool,
+    // STRING and ENUM values need the root, see _sarg_parse_str_slot
+    // and _sarg_parse_enum
+    NULL,
+    NULL,
+    _sarg_parse_size,
+    _sarg_parse_duration
+};
+
+/* longest number representation accepted by the conversion */
+#define _SARG_MAX_NUM_LEN 255
+
+/**
+ * Maps the hash of a name to a slot of a choice table.
+ */
+#define _SARG_CHOICE_SLOT(hash, seed, shift) \
+    ((((hash) ^ (seed)) * 2654435761u) >> (shift))
+
+/**
+ * Converts the name of a choice to its index. The perfect hash leads
+ * to the only candidate, so at most one name is compared.
+ */
+_SARG_INTERNAL int _sarg_parse_enum(sarg_root *root, const int idx, const char *arg,
+                                    const int len, sarg_result *res)
+{
+    const _sarg_choices *choices;
+    int choice;
+
+    if(!root->choices || !root->choices[idx].names)
+        return SARG_ERR_PARSE;
+
+    choices = &root->choices[idx];
+    choice = choices->table[_SARG_CHOICE_SLOT(_sarg_hash(arg, len),
+                                              choices->seed, choices->shift)];
+    if(choice < 0 || _sarg_name_cmp(choices->names[choice], arg, len) != 0)
+        return SARG_ERR_PARSE;
+
+    res->int_val = choice;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Checks the converted number of the given option against its range.
+ */
+_SARG_INTERNAL int _sarg_check_range(const sarg_root *root, const int idx,
+                                     const sarg_result *res)
+{
+    const _sarg_range *range;
+    double val;
+
+    if(!root->ranges || !root->ranges[idx].set)
+        return SARG_ERR_SUCCESS;
+
+    range = &root->ranges[idx];
+    switch(res->type) {
+    case INT:
+        val = res->int_val;
+        break;
+    case UINT:
+        val = res->uint_val;
+        break;
+    case SIZE:
+        val = (double) res->size_val;
+        break;
+    case DURATION:
+        val = (double) res->duration_val;
+        break;
+    default:
+        val = res->double_val;
+        break;
+    }
+
+    // NaN is never within range
+    if(!(val >= range->min && val <= range->max))
+        return SARG_ERR_RANGE;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Converts the value of length len, which does not need to be
+ * NUL-terminated, and stores it in the result of the given option.
+ */
+_SARG_INTERNAL int _sarg_parse_value(sarg_root *root, const int idx, const char *arg,
+                                     const int len)
+{
+    sarg_result *res = &root->results[idx];
+    sarg_result val;
+    char num[_SARG_MAX_NUM_LEN + 1];
+    int ret;
+
+    switch(res->type) {
+    case BOOL:
+        return _sarg_parse_bool(arg, res);
+    case ENUM:
+        return _sarg_parse_enum(root, idx, arg, len, res);
+    case STRING:
+        if(root->flags & SARG_ROOT_STATIC)
+            return _sarg_parse_str_static(root, arg, len, res);
+#ifndef SARG_NO_MALLOC
+        return _sarg_parse_str_slot(root, idx, arg, len, res);
+#else
+        return SARG_ERR_ALLOC;
+#endif
+    default:
+        // numbers are converted from a terminated copy on the stack
+        if(len > _SARG_MAX_NUM_LEN)
+            return SARG_ERR_PARSE;
+        memcpy(num, arg, len);
+        num[len] = '\0';
+
+        // the result keeps its value if the new one is rejected
+        val = *res;
+        ret = _sarg_parse_funcs[res->type](num, &val);
+        if(ret == SARG_ERR_SUCCESS)
+            ret = _sarg_check_range(root, idx, &val);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+        *res = val;
+
+        return SARG_ERR_SUCCESS;
+    }
+}
+
+/**
+ * Stores the value of the given option, counts its appearance and
+ * calls its callback.
+ */
+_SARG_INTERNAL int _sarg_apply_opt(sarg_root *root, const int idx, const char *arg,
+                                   const int len)
+{
+    int ret;
+
+    ret = _sarg_parse_value(root, idx, arg, len);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    ++root->results[idx].count;
+    if(root->seen)
+        root->seen[idx / _SARG_WORD_BITS] |= 1UL << (idx % _SARG_WORD_BITS);
+
+    // call callback if it was set
+    if(root->opts[idx].callback)
+        return root->opts[idx].callback(&root->results[idx]);
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Sets the given option to a value, which was attached to its name
+ * or read from a configuration file. BOOL options are set to the
+ * boolean word instead of being toggled and to true if arg is NULL.
+ */
+_SARG_INTERNAL int _sarg_apply_set(sarg_root *root, const int idx, const char *arg,
+                                   const int len)
+{
+    int ret, val;
+
+    if(root->opts[idx].type == BOOL) {
+        val = 1;
+        if(arg) {
+            ret = _sarg_parse_bool_word(arg, len, &val);
             if(ret != SARG_ERR_SUCCESS)
                 return ret;
+        }
+        // applying the option toggles the value
+        root->results[idx].bool_val = !val;
+        return _sarg_apply_opt(root, idx, NULL, 0);
+    }
+
+    if(!arg)
+        return SARG_ERR_PARSE;
+
+    return _sarg_apply_opt(root, idx, arg, len);
+}
+
+/* kinds of arguments, see _sarg_lex */
+#define _SARG_TOK_VALUE       0
+#define _SARG_TOK_SHORT       1
+#define _SARG_TOK_LONG        2
+#define _SARG_TOK_END         3
+#define _SARG_TOK_RESPONSE    4
+
+typedef struct _sarg_token {
+    int kind;
+    int len;
+    // option name without dashes or path of a response file
+    const char *name;
+    int name_len;
+    // value attached to a long option with '=' or NULL
+    const char *value;
+    int value_len;
+} _sarg_token;
+
+/**
+ * Classifies an argument in a single pass and splits "--name=value"
+ * at the first '='. Name and value point into the argument. A negative
+ * len reads up to the terminating NUL and stores the length in the
+ * token, so argv is never scanned twice. "-" is a value, e.g. stdin.
+ */
+_SARG_INTERNAL void _sarg_lex(const char *arg, const int len, _sarg_token *tok)
+{
+    int i, eq;
+
+    eq = -1;
+    for(i = 0; len < 0 ? arg[i] != '\0' : i < len; ++i) {
+        if(arg[i] == '=' && eq < 0)
+            eq = i;
+    }
+
+    tok->len = i;
+    tok->value = NULL;
+    tok->value_len = 0;
+
+    if(i > 1 && arg[0] == '-' && arg[1] == '-') {
+        tok->kind = i == 2 ? _SARG_TOK_END : _SARG_TOK_LONG;
+        tok->name = &arg[2];
+        tok->name_len = (eq < 0 ? i : eq) - 2;
+        if(eq >= 0) {
+            tok->value = &arg[eq + 1];
+            tok->value_len = i - eq - 1;
+        }
+    } else if(i > 1 && (arg[0] == '-' || arg[0] == '@')) {
+        tok->kind = arg[0] == '-' ? _SARG_TOK_SHORT : _SARG_TOK_RESPONSE;
+        tok->name = &arg[1];
+        tok->name_len = i - 1;
+    } else {
+        tok->kind = _SARG_TOK_VALUE;
+        tok->name = arg;
+        tok->name_len = i;
+    }
+}
+
+#ifndef SARG_MAX_FILE_DEPTH
+#define SARG_MAX_FILE_DEPTH 8
+#endif
+
+typedef struct _sarg_parse_ctx {
+    // option which waits for its value or -1
+    int pending;
+    // "--" appeared, all following arguments are positional
+    int rest;
+    // identities of the response files currently being parsed
+    int depth;
+    unsigned long file_ids[SARG_MAX_FILE_DEPTH][2];
+} _sarg_parse_ctx;
+
+#ifndef SARG_NO_FILE
+_SARG_INTERNAL int _sarg_parse_response(sarg_root *root, _sarg_parse_ctx *ctx,
+                                        const char *path, const int len);
+#endif
+
+/**
+ * Applies a BOOL option or remembers any other option in the context
+ * until its value arrives with the next argument.
+ */
+_SARG_INTERNAL int _sarg_take_opt(sarg_root *root, _sarg_parse_ctx *ctx, const int idx)
+{
+    if(root->results[idx].type != BOOL) {
+        ctx->pending = idx;
+        return SARG_ERR_SUCCESS;
+    }
+
+    return _sarg_apply_opt(root, idx, NULL, 0);
+}
+
+/**
+ * Processes "--name" or "--name=value". Long names may be abbreviated.
+ */
+_SARG_INTERNAL int _sarg_parse_long(sarg_root *root, _sarg_parse_ctx *ctx,
+                                    const _sarg_token *tok)
+{
+    int idx;
+
+    idx = _sarg_find_opt_n(root, tok->name, tok->name_len);
+    if(idx < 0 && tok->name_len > 0)
+        idx = _sarg_find_long_prefix(root, tok->name, tok->name_len);
+    if(idx < 0)
+        return idx == SARG_ERR_AMBIGUOUS ? idx : SARG_ERR_NOTFOUND;
+
+    if(tok->value)
+        return _sarg_apply_set(root, idx, tok->value, tok->value_len);
+
+    return _sarg_take_opt(root, ctx, idx);
+}
+
+/**
+ * Processes "-n", "-n5" or a cluster of flags like "-abc". A whole
+ * name wins over a cluster, so short names of several characters keep
+ * working. In a cluster the first option which expects a value takes
+ * the rest of the argument as its value.
+ */
+_SARG_INTERNAL int _sarg_parse_short(sarg_root *root, _sarg_parse_ctx *ctx,
+                                     const _sarg_token *tok)
+{
+    int i, idx, ret;
+
+    idx = _sarg_find_opt_n(root, tok->name, tok->name_len);
+    if(idx >= 0)
+        return _sarg_take_opt(root, ctx, idx);
+
+    for(i = 0; i < tok->name_len; ++i) {
+        idx = _sarg_find_opt_n(root, &tok->name[i], 1);
+        if(idx < 0)
+            return SARG_ERR_NOTFOUND;
+
+        if(root->results[idx].type != BOOL) {
+            if(i + 1 == tok->name_len) {
+                ctx->pending = idx;
+                return SARG_ERR_SUCCESS;
+            }
+            return _sarg_apply_opt(root, idx, &tok->name[i + 1],
+                                   tok->name_len - i - 1);
+        }
+
+        ret = _sarg_apply_opt(root, idx, NULL, 0);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Processes a single argument classified by _sarg_lex. Values which do
+ * not belong to an option are skipped, the caller decides whether they
+ * are positional.
+ */
+_SARG_INTERNAL int _sarg_parse_token(sarg_root *root, _sarg_parse_ctx *ctx, const char *arg,
+                                     const _sarg_token *tok)
+{
+    int idx;
+
+    if(ctx->pending >= 0) {
+        idx = ctx->pending;
+        ctx->pending = -1;
+        return _sarg_apply_opt(root, idx, arg, tok->len);
+    }
+    if(ctx->rest)
+        return SARG_ERR_SUCCESS;
+
+    switch(tok->kind) {
+    case _SARG_TOK_SHORT:
+        return _sarg_parse_short(root, ctx, tok);
+    case _SARG_TOK_LONG:
+        return _sarg_parse_long(root, ctx, tok);
+    case _SARG_TOK_END:
+        ctx->rest = 1;
+        return SARG_ERR_SUCCESS;
+#ifndef SARG_NO_FILE
+    case _SARG_TOK_RESPONSE:
+        return _sarg_parse_response(root, ctx, tok->name, tok->name_len);
+#endif
+    default:
+        return SARG_ERR_SUCCESS;
+    }
+}
+
+/**
+ * Processes a single argument, which does not need to be
+ * NUL-terminated.
+ */
+_SARG_INTERNAL int _sarg_parse_arg(sarg_root *root, _sarg_parse_ctx *ctx, const char *arg,
+                                   const int len)
+{
+    _sarg_token tok;
+
+    _sarg_lex(arg, len, &tok);
+    return _sarg_parse_token(root, ctx, arg, &tok);
+}
+
+#define _SARG_IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' \
+                           || (c) == '\r' || (c) == '\v' || (c) == '\f')
+#define _SARG_IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+#ifndef SARG_NO_FILE
+
+#if defined(__unix__) || defined(__APPLE__)
+#define _SARG_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <stdio.h>
+
+typedef struct _sarg_file_map {
+    char *data;
+    size_t len;
+    unsigned long id[2];
+    int mapped;
+} _sarg_file_map;
+
+/**
+ * Maps the given file into memory. Where mmap is not available, the
+ * file is read into a heap buffer instead.
+ */
+_SARG_INTERNAL int _sarg_file_map_open(sarg_root *root, const char *path, _sarg_file_map *map)
+{
+    memset(map, 0, sizeof(_sarg_file_map));
+
+#ifdef _SARG_HAVE_MMAP
+    struct stat st;
+    int fd;
+
+    _SARG_UNUSED(root);
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return SARG_ERR_ERRNO;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return SARG_ERR_ERRNO;
+    }
+
+    map->id[0] = (unsigned long) st.st_dev;
+    map->id[1] = (unsigned long) st.st_ino;
+    map->len = st.st_size;
+    if(map->len > 0) {
+        map->data = (char *) mmap(NULL, map->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map->data == MAP_FAILED) {
+            map->data = NULL;
+            close(fd);
+            return SARG_ERR_ERRNO;
+        }
+        map->mapped = 1;
+    }
+    close(fd);
+#else
+    FILE *fp;
+    long len;
 
-            ++root->results[arg_idx].count;
+    fp = fopen(path, "rb");
+    if(!fp)
+        return SARG_ERR_ERRNO;
+    if(fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0
+       || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return SARG_ERR_ERRNO;
+    }
+
+    map->len = len;
+    if(map->len > 0) {
+        map->data = (char *) _sarg_malloc(root, map->len);
+        if(!map->data) {
+            fclose(fp);
+            return SARG_ERR_ALLOC;
+        }
+        if(fread(map->data, 1, map->len, fp) != map->len) {
+            _sarg_free(root, map->data);
+            map->data = NULL;
+            fclose(fp);
+            return SARG_ERR_ERRNO;
+        }
+    }
+    fclose(fp);
+#endif
+
+    return SARG_ERR_SUCCESS;
+}
+
+_SARG_INTERNAL void _sarg_file_map_close(sarg_root *root, _sarg_file_map *map)
+{
+    _SARG_UNUSED(root);
+
+    if(map->data) {
+#ifdef _SARG_HAVE_MMAP
+        if(map->mapped)
+            munmap(map->data, map->len);
+#else
+        _sarg_free(root, map->data);
+#endif
+    }
+    map->data = NULL;
+    map->len = 0;
+}
+
+/**
+ * Splits the given buffer at whitespace and passes every argument to
+ * _sarg_parse_arg. Arguments may be enclosed in single or double
+ * quotes to contain whitespace. The arguments point into the buffer,
+ * nothing is copied.
+ */
+_SARG_INTERNAL int _sarg_parse_buffer(sarg_root *root, _sarg_parse_ctx *ctx,
+                                      const char *buf, const size_t len)
+{
+    size_t pos, start;
+    char quote;
+    int ret;
+
+    pos = 0;
+    while(pos < len) {
+        while(pos < len && _SARG_IS_SPACE(buf[pos]))
+            ++pos;
+        if(pos >= len)
+            break;
+
+        if(buf[pos] == '"' || buf[pos] == '\'') {
+            quote = buf[pos];
+            start = ++pos;
+            while(pos < len && buf[pos] != quote)
+                ++pos;
+            if(pos >= len)
+                return SARG_ERR_PARSE;
+            ret = _sarg_parse_arg(root, ctx, &buf[start], pos - start);
+            ++pos;
+        } else {
+            start = pos;
+            while(pos < len && !_SARG_IS_SPACE(buf[pos]))
+                ++pos;
+            ret = _sarg_parse_arg(root, ctx, &buf[start], pos - start);
+        }
+
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Parses the arguments of a response file in place of the "@path"
+ * argument. Response files may reference other response files up to
+ * SARG_MAX_FILE_DEPTH levels, but must not reference themselves.
+ */
+_SARG_INTERNAL int _sarg_parse_response(sarg_root *root, _sarg_parse_ctx *ctx,
+                                        const char *path, const int len)
+{
+    char filename[FILENAME_MAX];
+    _sarg_file_map map;
+    int i, ret;
+
+    if(len <= 0 || len >= FILENAME_MAX)
+        return SARG_ERR_INVALARG;
+    if(ctx->depth >= SARG_MAX_FILE_DEPTH)
+        return SARG_ERR_RECURSION;
+
+    memcpy(filename, path, len);
+    filename[len] = '\0';
+
+    ret = _sarg_file_map_open(root, filename, &map);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+#ifdef _SARG_HAVE_MMAP
+    for(i = 0; i < ctx->depth; ++i) {
+        if(ctx->file_ids[i][0] == map.id[0] && ctx->file_ids[i][1] == map.id[1]) {
+            _sarg_file_map_close(root, &map);
+            return SARG_ERR_RECURSION;
+        }
+    }
+#else
+    _SARG_UNUSED(i);
+#endif
+
+    ctx->file_ids[ctx->depth][0] = map.id[0];
+    ctx->file_ids[ctx->depth][1] = map.id[1];
+    ++ctx->depth;
+
+    ret = _sarg_parse_buffer(root, ctx, map.data, map.len);
+    // an option at the end of a file must not take its value from outside
+    if(ret == SARG_ERR_SUCCESS && ctx->pending >= 0)
+        ret = SARG_ERR_PARSE;
+
+    --ctx->depth;
+    _sarg_file_map_close(root, &map);
+
+    return ret;
+}
+
+#endif
+
+/**
+ * Returns the index of the lowest bit set in the given word.
+ */
+_SARG_INTERNAL int _sarg_lowest_bit(unsigned long word)
+{
+    int i;
+
+    for(i = 0; !(word & 1UL); ++i)
+        word >>= 1;
+
+    return i;
+}
+
+/**
+ * @brief Checks the rules added with sarg_add_rule.
+ *
+ * Each rule is a bitmask of options, which is compared with the
+ * options that appeared so far one word at a time. sarg_parse and
+ * sarg_parse_string call this function when they are done. Call it
+ * explicitly after parsing only configuration files.
+ *
+ * On failure the index of an option which violates the rule is stored
+ * in root->err_opt, otherwise it is set to -1. For SARG_RULE_EXCLUSIVE
+ * this is the conflicting option with the higher index.
+ *
+ * @param root root object which parsed its arguments
+ *
+ * @return SARG_ERR_SUCCESS on success, SARG_ERR_MISSING if a required
+ *         option is missing or SARG_ERR_CONFLICT if exclusive options
+ *         appeared together
+ */
+int sarg_check(sarg_root *root)
+{
+    const unsigned long *mask;
+    unsigned long hit;
+    int i, w, found;
+
+    root->err_opt = -1;
+    for(i = 0; i < root->rule_len; ++i) {
+        mask = &root->rule_masks[i * root->mask_len];
+
+        switch(root->rules[i].type) {
+        case SARG_RULE_DEPENDS:
+            w = root->rules[i].opt;
+            if(!(root->seen[w / _SARG_WORD_BITS] & (1UL << (w % _SARG_WORD_BITS))))
+                break;
+            // fall through
+        case SARG_RULE_REQUIRED:
+            for(w = 0; w < root->mask_len; ++w) {
+                hit = mask[w] & ~root->seen[w];
+                if(hit) {
+                    root->err_opt = w * _SARG_WORD_BITS + _sarg_lowest_bit(hit);
+                    return SARG_ERR_MISSING;
+                }
+            }
+            break;
+        case SARG_RULE_EXCLUSIVE:
+            found = 0;
+            for(w = 0; w < root->mask_len; ++w) {
+                hit = mask[w] & root->seen[w];
+                if(!hit)
+                    continue;
+                // drop the first option that appeared
+                if(!found) {
+                    hit &= hit - 1;
+                    found = 1;
+                }
+                if(hit) {
+                    root->err_opt = w * _SARG_WORD_BITS + _sarg_lowest_bit(hit);
+                    return SARG_ERR_CONFLICT;
+                }
+            }
+            break;
+        }
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+#ifndef SARG_NO_MALLOC
+
+/**
+ * @brief Sets the default value of the given option.
+ *
+ * The value is converted once and stored with the root. The option
+ * holds the default until it appears while parsing and gets it back
+ * on sarg_reset. Its count stays 0, so defaults can be told apart
+ * from given values. BOOL options accept the same words as
+ * configuration files, e.g. "true" or "off". Appearing on the command
+ * line still toggles their value. ENUM options need their choices and
+ * numbers are checked against their range, so set these first.
+ *
+ * @param root initialized root object, which must not be static
+ * @param name short or long name of the option
+ * @param value default value as it would be passed on the command line
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_set_default(sarg_root *root, const char *name, const char *value)
+{
+    sarg_result res;
+    int i, idx, ret, len;
+
+    if(root->flags & (SARG_ROOT_STATIC | SARG_ROOT_BORROWED))
+        return SARG_ERR_INVALARG;
+
+    idx = _sarg_find_opt(root, name);
+    if(idx < 0)
+        return SARG_ERR_NOTFOUND;
+
+    if(!root->defaults) {
+        root->defaults = (sarg_result *) _sarg_malloc(root, sizeof(sarg_result) * root->res_len);
+        if(!root->defaults)
+            return SARG_ERR_ALLOC;
+        for(i = 0; i < root->res_len; ++i)
+            _sarg_result_init(&root->defaults[i], root->results[i].type);
+    }
+
+    _sarg_result_init(&res, root->results[idx].type);
+    len = strlen(value);
+    switch(res.type) {
+    case BOOL:
+        ret = _sarg_parse_bool_word(value, len, &res.bool_val);
+        break;
+    case STRING:
+        ret = _sarg_parse_str_n(root, value, len, &res);
+        break;
+    case ENUM:
+        ret = _sarg_parse_enum(root, idx, value, len, &res);
+        break;
+    default:
+        ret = _sarg_parse_funcs[res.type](value, &res);
+        if(ret == SARG_ERR_SUCCESS)
+            ret = _sarg_check_range(root, idx, &res);
+        break;
+    }
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    _sarg_result_destroy(root, &root->defaults[idx]);
+    root->defaults[idx] = res;
+    if(root->results[idx].count == 0)
+        root->results[idx] = res;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * @brief Adds a rule on the appearance of the given options.
+ *
+ * The options are compiled into a bitmask, which sarg_check compares
+ * with the options that appeared. See SARG_RULE_* for the available
+ * rules. A rule naming an unknown option is not added.
+ *
+ * @param root initialized root object, which must not be static
+ * @param type one of the SARG_RULE_* rules
+ * @param names NULL-terminated array of short or long option names
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_add_rule(sarg_root *root, const int type, const char **names)
+{
+    _sarg_rule *rules;
+    unsigned long *masks, *mask;
+    int i, idx, words;
+
+    if(root->flags & (SARG_ROOT_STATIC | SARG_ROOT_BORROWED) || !names[0])
+        return SARG_ERR_INVALARG;
+    if(type != SARG_RULE_REQUIRED && type != SARG_RULE_EXCLUSIVE
+       && type != SARG_RULE_DEPENDS)
+        return SARG_ERR_INVALARG;
+
+    for(i = 0; names[i]; ++i) {
+        if(_sarg_find_opt(root, names[i]) < 0)
+            return SARG_ERR_NOTFOUND;
+    }
+
+    words = (root->opt_len + _SARG_WORD_BITS - 1) / _SARG_WORD_BITS;
+    if(!root->seen) {
+        root->seen = (unsigned long *) _sarg_calloc(root, words, sizeof(unsigned long));
+        if(!root->seen)
+            return SARG_ERR_ALLOC;
+        root->mask_len = words;
+
+        // options may have appeared before the first rule was added
+        for(i = 0; i < root->res_len; ++i) {
+            if(root->results[i].count > 0)
+                root->seen[i / _SARG_WORD_BITS] |= 1UL << (i % _SARG_WORD_BITS);
+        }
+    }
+
+    rules = (_sarg_rule *) _sarg_realloc(root, root->rules,
+                                   sizeof(_sarg_rule) * (root->rule_len + 1));
+    if(!rules)
+        return SARG_ERR_ALLOC;
+    root->rules = rules;
+
+    masks = (unsigned long *) _sarg_realloc(root, root->rule_masks,
+        sizeof(unsigned long) * words * (root->rule_len + 1));
+    if(!masks)
+        return SARG_ERR_ALLOC;
+    root->rule_masks = masks;
+
+    mask = &masks[words * root->rule_len];
+    memset(mask, 0, sizeof(unsigned long) * words);
+    rules[root->rule_len].type = type;
+    rules[root->rule_len].opt = -1;
+    for(i = 0; names[i]; ++i) {
+        idx = _sarg_find_opt(root, names[i]);
+        if(type == SARG_RULE_DEPENDS && i == 0)
+            rules[root->rule_len].opt = idx;
+        else
+            mask[idx / _SARG_WORD_BITS] |= 1UL << (idx % _SARG_WORD_BITS);
+    }
+    ++root->rule_len;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/* seeds tried for one table size before it is doubled */
+#define _SARG_CHOICE_SEEDS 64
+/* largest table, which is only exceeded by duplicate names */
+#define _SARG_CHOICE_MAX_BITS 20
+
+/**
+ * @brief Sets the allowed values of the given ENUM option.
+ *
+ * An ENUM option stores the index of the given name in int_val. At
+ * this point a perfect hash of the names is built: a seed is searched
+ * for which all names end up in different slots of a table of at least
+ * twice the number of names. Parsing a value then hashes it once and
+ * compares it with a single name.
+ *
+ * The array is referenced and has to outlive the root.
+ *
+ * @param root initialized root object, which must not be static
+ * @param name short or long name of the ENUM option
+ * @param choices NULL-terminated array of allowed values
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise,
+ *         SARG_ERR_INVALARG if names are duplicated or share a hash
+ */
+int sarg_set_choices(sarg_root *root, const char *name, const char **choices)
+{
+    _sarg_choices *entry;
+    unsigned int *hashes;
+    unsigned int seed, slot;
+    int *table, *grown;
+    int i, j, idx, len, bits;
+
+    if(root->flags & (SARG_ROOT_STATIC | SARG_ROOT_BORROWED) || !choices[0])
+        return SARG_ERR_INVALARG;
+
+    idx = _sarg_find_opt(root, name);
+    if(idx < 0)
+        return SARG_ERR_NOTFOUND;
+    if(root->opts[idx].type != ENUM)
+        return SARG_ERR_INVALARG;
+
+    if(!root->choices) {
+        root->choices = (_sarg_choices *) _sarg_calloc(root, root->opt_len, sizeof(_sarg_choices));
+        if(!root->choices)
+            return SARG_ERR_ALLOC;
+    }
+
+    for(len = 0; choices[len]; ++len);
+    for(bits = 1; (1 << bits) < 2 * len; ++bits);
+
+    // names are hashed once, seeds only remix the hashes
+    hashes = (unsigned int *) _sarg_malloc(root, sizeof(unsigned int) * len);
+    if(!hashes)
+        return SARG_ERR_ALLOC;
+    for(i = 0; i < len; ++i) {
+        hashes[i] = _sarg_hash(choices[i], strlen(choices[i]));
+        // no seed separates names with equal hashes
+        for(j = 0; j < i; ++j) {
+            if(hashes[j] == hashes[i]) {
+                _sarg_free(root, hashes);
+                return SARG_ERR_INVALARG;
+            }
+        }
+    }
+
+    table = NULL;
+    for(;; ++bits) {
+        if(bits > _SARG_CHOICE_MAX_BITS) {
+            _sarg_free(root, hashes);
+            _sarg_free(root, table);
+            return SARG_ERR_INVALARG;
+        }
+
+        grown = (int *) _sarg_realloc(root, table, sizeof(int) << bits);
+        if(!grown) {
+            _sarg_free(root, hashes);
+            _sarg_free(root, table);
+            return SARG_ERR_ALLOC;
+        }
+        table = grown;
+
+        for(seed = 0; seed < _SARG_CHOICE_SEEDS; ++seed) {
+            memset(table, -1, sizeof(int) << bits);
+            for(i = 0; i < len; ++i) {
+                slot = _SARG_CHOICE_SLOT(hashes[i], seed, 32 - bits);
+                if(table[slot] >= 0)
+                    break;
+                table[slot] = i;
+            }
+            if(i == len)
+                break;
+        }
+        if(seed < _SARG_CHOICE_SEEDS)
+            break;
+    }
+    _sarg_free(root, hashes);
+
+    entry = &root->choices[idx];
+    if(entry->table)
+        _sarg_free(root, entry->table);
+    entry->table = table;
+    entry->names = choices;
+    entry->len = len;
+    entry->seed = seed;
+    entry->shift = 32 - bits;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * @brief Restricts the values of the given number option to a range.
+ *
+ * Values of INT, UINT, DOUBLE, SIZE and DURATION options outside of
+ * min and max, inclusive, are rejected with SARG_ERR_RANGE right after
+ * their conversion. The option then keeps its previous value. Sizes
+ * are given in bytes and durations in nanoseconds.
+ *
+ * @param root initialized root object, which must not be static
+ * @param name short or long name of the option
+ * @param min smallest allowed value
+ * @param max largest allowed value
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_set_range(sarg_root *root, const char *name, const double min,
+                   const double max)
+{
+    int idx;
+
+    if(root->flags & (SARG_ROOT_STATIC | SARG_ROOT_BORROWED) || !(min <= max))
+        return SARG_ERR_INVALARG;
+
+    idx = _sarg_find_opt(root, name);
+    if(idx < 0)
+        return SARG_ERR_NOTFOUND;
+    if(root->opts[idx].type == BOOL || root->opts[idx].type == STRING
+       || root->opts[idx].type == ENUM)
+        return SARG_ERR_INVALARG;
+
+    if(!root->ranges) {
+        root->ranges = (_sarg_range *) _sarg_calloc(root, root->opt_len, sizeof(_sarg_range));
+        if(!root->ranges)
+            return SARG_ERR_ALLOC;
+    }
+
+    root->ranges[idx].min = min;
+    root->ranges[idx].max = max;
+    root->ranges[idx].set = 1;
+
+    return SARG_ERR_SUCCESS;
+}
+
+#endif
+
+/**
+ * Records the argv index of a positional argument. The array grows
+ * by doubling, static roots only record into their given buffer.
+ */
+_SARG_INTERNAL int _sarg_add_positional(sarg_root *root, const int idx)
+{
+    if(root->pos_len == root->pos_cap) {
+        // static roots without buffer skip positional arguments
+        if((root->flags & SARG_ROOT_STATIC) && !root->pos)
+            return SARG_ERR_SUCCESS;
+#ifndef SARG_NO_MALLOC
+        if(root->flags & SARG_ROOT_STATIC)
+            return SARG_ERR_ALLOC;
+
+        int cap = root->pos_cap > 0 ? 2 * root->pos_cap : 16;
+        int *pos = (int *) _sarg_realloc(root, root->pos, sizeof(int) * cap);
+        if(!pos)
+            return SARG_ERR_ALLOC;
+        root->pos = pos;
+        root->pos_cap = cap;
+#else
+        return SARG_ERR_ALLOC;
+#endif
+    }
+
+    root->pos[root->pos_len++] = idx;
+    return SARG_ERR_SUCCESS;
+}
+
+// flags of _sarg_parse_argv
+#define _SARG_PARSE_KEEP_POS 0x1
+#define _SARG_PARSE_CHECK    0x2
+
+/**
+ * Parses an argument vector. Only a vector given by the caller has
+ * indices worth keeping, so positional arguments of vectors built
+ * internally, e.g. from argument files, are skipped. The rules are
+ * only checked with _SARG_PARSE_CHECK, since a file may be followed
+ * by the arguments which satisfy them.
+ */
+_SARG_INTERNAL int _sarg_parse_argv(sarg_root *root, const char **argv, const int argc,
+                                    const int flags)
+{
+    int i, opt_pos, ret;
+    _sarg_parse_ctx ctx;
+    _sarg_token tok;
+
+    root->err_idx = -1;
+    if(flags & _SARG_PARSE_KEEP_POS)
+        root->pos_len = 0;
+    ctx.pending = -1;
+    ctx.rest = 0;
+    ctx.depth = 0;
+    opt_pos = 0;
+
+    for(i = 1; i < argc; ++i) {
+        _sarg_lex(argv[i], -1, &tok);
+
+        if(ctx.pending < 0 && (ctx.rest || tok.kind == _SARG_TOK_VALUE)) {
+#ifndef SARG_NO_MALLOC
+            if(!ctx.rest && root->cmd_len > 0) {
+                // first positional argument selects the subcommand
+                ret = _sarg_find_cmd_n(root, argv[i], tok.len);
+                if(ret < 0) {
+                    ret = SARG_ERR_NOTFOUND;
+                    goto _sarg_parse_exit;
+                }
+
+                ret = _sarg_cmd_select(root, ret);
+                if(ret != SARG_ERR_SUCCESS)
+                    goto _sarg_parse_exit;
+
+                // the command name takes the place of the program name
+                ret = _sarg_parse_argv(root->cmd_root, &argv[i], argc - i,
+                                       flags);
+                if(ret != SARG_ERR_SUCCESS) {
+                    if(root->cmd_root->err_idx >= 0)
+                        i += root->cmd_root->err_idx;
+                    goto _sarg_parse_exit;
+                }
+
+                return flags & _SARG_PARSE_CHECK ? sarg_check(root)
+                                                 : SARG_ERR_SUCCESS;
+            }
+#endif
+
+            ret = flags & _SARG_PARSE_KEEP_POS ? _sarg_add_positional(root, i)
+                                               : SARG_ERR_SUCCESS;
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_parse_exit;
+            continue;
+        }
+
+        if(ctx.pending < 0)
+            opt_pos = i;
+
+        ret = _sarg_parse_token(root, &ctx, argv[i], &tok);
+        if(ret != SARG_ERR_SUCCESS)
+            goto _sarg_parse_exit;
+    }
+
+    // last option is missing its value
+    if(ctx.pending >= 0) {
+        i = opt_pos;
+        ret = SARG_ERR_PARSE;
+        goto _sarg_parse_exit;
+    }
+
+    return flags & _SARG_PARSE_CHECK ? sarg_check(root) : SARG_ERR_SUCCESS;
+
+_sarg_parse_exit:
+    root->err_idx = i;
+    return ret;
+}
+
+/**
+ * @brief Parses the given arguments with the given root object.
+ *
+ * The root object has to be initialized with sarg_init before
+ * being passed to this function.
+ *
+ * If specified this function will call callback functions on the
+ * appearance of the corresponding options.
+ *
+ * An argument of the form "@path" is replaced by the arguments in the
+ * given response file. These are separated by whitespace and may be
+ * quoted with single or double quotes. Response files can be nested.
+ *
+ * Arguments which are neither options nor option values are
+ * positional, as is everything after "--". Their indices in argv are
+ * kept without copying, see sarg_positionals.
+ *
+ * On failure the index of the argument that caused the error is
+ * stored in root->err_idx, otherwise it is set to -1.
+ *
+ * Afterwards the rules of sarg_add_rule are checked, see sarg_check.
+ *
+ * @param root root object which should be used to parse arguments
+ * @param argv array of arguments to be parsed
+ * @param argc number of elements in argv
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse(sarg_root *root, const char **argv, const int argc)
+{
+    return _sarg_parse_argv(root, argv, argc,
+                            _SARG_PARSE_KEEP_POS | _SARG_PARSE_CHECK);
+}
+
+#ifndef SARG_NO_MALLOC
+
+/**
+ * Prepares a parse into a layer. Results start over from the defaults,
+ * so every layer holds what parsing it alone would give, and rules are
+ * put aside until all layers are resolved.
+ */
+_SARG_INTERNAL int _sarg_layer_begin(sarg_root *root, const int layer, int *rule_len)
+{
+    int pos_len;
+
+    if((root->flags & SARG_ROOT_STATIC) || layer < 0 || layer >= SARG_MAX_LAYERS)
+        return SARG_ERR_INVALARG;
+
+    if(!root->layers) {
+        root->layers = (_sarg_layer *) _sarg_calloc(root, SARG_MAX_LAYERS, sizeof(_sarg_layer));
+        if(!root->layers)
+            return SARG_ERR_ALLOC;
+    }
+
+    // positional arguments of an earlier argv stay valid
+    pos_len = root->pos_len;
+    sarg_reset(root);
+    root->pos_len = pos_len;
+
+    *rule_len = root->rule_len;
+    root->rule_len = 0;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Copies the results that appeared into a single allocation, which
+ * replaces the former contents of the layer.
+ */
+_SARG_INTERNAL int _sarg_layer_store(sarg_root *root, _sarg_layer *layer)
+{
+    sarg_result *results;
+    size_t size, str_len;
+    char *str;
+    int i, len;
+
+    len = 0;
+    str_len = 0;
+    for(i = 0; i < root->res_len; ++i) {
+        if(root->results[i].count == 0)
+            continue;
+        ++len;
+        if(root->results[i].type == STRING && root->results[i].str_val)
+            str_len += strlen(root->results[i].str_val) + 1;
+    }
+
+    results = NULL;
+    if(len > 0) {
+        size = (sizeof(sarg_result) + sizeof(int)) * len + str_len;
+        results = (sarg_result *) _sarg_malloc(root, size);
+        if(!results)
+            return SARG_ERR_ALLOC;
+    }
+
+    if(layer->results)
+        _sarg_free(root, layer->results);
+    memset(layer, 0, sizeof(_sarg_layer));
+    if(len == 0)
+        return SARG_ERR_SUCCESS;
+
+    layer->results = results;
+    layer->opts = (int *) &results[len];
+
+    str = (char *) &layer->opts[len];
+    for(i = 0; i < root->res_len; ++i) {
+        if(root->results[i].count == 0)
+            continue;
+        results[layer->len] = root->results[i];
+        if(root->results[i].type == STRING && root->results[i].str_val) {
+            strcpy(str, root->results[i].str_val);
+            results[layer->len].str_val = str;
+            str += strlen(str) + 1;
+        }
+        layer->opts[layer->len++] = i;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Builds the effective results from the defaults and all layers from
+ * the lowest to the highest, then checks the rules on them.
+ */
+_SARG_INTERNAL int _sarg_layer_resolve(sarg_root *root)
+{
+    const _sarg_layer *layer;
+    int i, l, idx, err_idx, pos_len;
+
+    err_idx = root->err_idx;
+    pos_len = root->pos_len;
+    sarg_reset(root);
+    root->err_idx = err_idx;
+    root->pos_len = pos_len;
+
+    for(l = 0; l < SARG_MAX_LAYERS; ++l) {
+        layer = &root->layers[l];
+        for(i = 0; i < layer->len; ++i) {
+            idx = layer->opts[i];
+            root->results[idx] = layer->results[i];
+            if(root->seen)
+                root->seen[idx / _SARG_WORD_BITS] |= 1UL << (idx % _SARG_WORD_BITS);
+        }
+    }
+
+    return sarg_check(root);
+}
+
+/**
+ * Stores a successfully parsed layer and resolves the effective
+ * results. A failed parse keeps the former contents of the layer.
+ */
+_SARG_INTERNAL int _sarg_layer_end(sarg_root *root, const int layer, const int rule_len,
+                                   int ret)
+{
+    root->rule_len = rule_len;
+    if(ret == SARG_ERR_SUCCESS)
+        ret = _sarg_layer_store(root, &root->layers[layer]);
+
+    if(ret != SARG_ERR_SUCCESS) {
+        _sarg_layer_resolve(root);
+        return ret;
+    }
+
+    return _sarg_layer_resolve(root);
+}
+
+/**
+ * @brief Parses the given arguments into a layer of the root.
+ *
+ * Each layer keeps only the results of the options that appeared in
+ * it. The results of the root are the effective view: an option holds
+ * the result of the highest layer it appeared in, otherwise its
+ * default. So a BOOL option is toggled at most once, no matter how many
+ * layers mention it. Parsing a layer again replaces it without parsing
+ * the other layers, e.g. when a user file is reloaded.
+ *
+ * Rules are checked on the effective results only. On a parse error
+ * the layer keeps its former contents. sarg_reset goes back to the
+ * defaults, but keeps the layers for the next layer call.
+ *
+ * @param root initialized root object, which must not be static
+ * @param layer one of SARG_LAYER_* or any layer below SARG_MAX_LAYERS
+ * @param argv array of arguments to be parsed
+ * @param argc number of elements in argv
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_layer_parse(sarg_root *root, const int layer, const char **argv,
+                     const int argc)
+{
+    int ret, rule_len;
+
+    ret = _sarg_layer_begin(root, layer, &rule_len);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    ret = sarg_parse(root, argv, argc);
+    return _sarg_layer_end(root, layer, rule_len, ret);
+}
+
+/**
+ * @brief Parses the given command line into a layer of the root.
+ *
+ * Like sarg_layer_parse, but splits cmdline like sarg_parse_string,
+ * e.g. for arguments from an environment variable.
+ *
+ * @param root initialized root object, which must not be static
+ * @param layer one of SARG_LAYER_* or any layer below SARG_MAX_LAYERS
+ * @param cmdline NUL-terminated command line
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_layer_parse_string(sarg_root *root, const int layer,
+                            const char *cmdline)
+{
+    int ret, rule_len;
+
+    ret = _sarg_layer_begin(root, layer, &rule_len);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    ret = sarg_parse_string(root, cmdline);
+    return _sarg_layer_end(root, layer, rule_len, ret);
+}
+
+#ifndef SARG_NO_FILE
+
+/**
+ * @brief Parses the given argument file into a layer of the root.
+ *
+ * Like sarg_layer_parse, but reads the arguments like sarg_parse_file.
+ *
+ * @param root initialized root object, which must not be static
+ * @param layer one of SARG_LAYER_* or any layer below SARG_MAX_LAYERS
+ * @param filename path of the argument file
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_layer_parse_file(sarg_root *root, const int layer,
+                          const char *filename)
+{
+    int ret, rule_len;
+
+    ret = _sarg_layer_begin(root, layer, &rule_len);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    ret = sarg_parse_file(root, filename);
+    return _sarg_layer_end(root, layer, rule_len, ret);
+}
+
+#endif
+
+/**
+ * @brief Drops a layer of the root and resolves the effective results.
+ *
+ * @param root initialized root object, which must not be static
+ * @param layer layer to drop
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_layer_clear(sarg_root *root, const int layer)
+{
+    int ret, rule_len;
+
+    ret = _sarg_layer_begin(root, layer, &rule_len);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    if(root->layers[layer].results)
+        _sarg_free(root, root->layers[layer].results);
+    memset(&root->layers[layer], 0, sizeof(_sarg_layer));
+
+    root->rule_len = rule_len;
+    return _sarg_layer_resolve(root);
+}
+
+#endif
+
+/**
+ * @brief Returns the positional arguments of the last sarg_parse.
+ *
+ * The indices refer to the argv given to sarg_parse and are valid until
+ * the next parse or sarg_reset. Positional arguments of a subcommand
+ * are kept by its root, see sarg_command_root, and count from the
+ * command name. Arguments of response files or sarg_parse_string are
+ * not recorded. Static roots only record them with storage->pos_buf.
+ *
+ * @param root root object which parsed the arguments
+ * @param indices set to the array of argv indices, may be NULL
+ *
+ * @return number of positional arguments
+ */
+int sarg_positionals(sarg_root *root, const int **indices)
+{
+    if(indices)
+        *indices = root->pos;
+
+    return root->pos_len;
+}
+
+/**
+ * Returns scratch memory of at least len bytes for unescaping
+ * arguments and stores its actual size in cap. Heap roots keep one
+ * growing buffer, static roots lend the unused part of their string
+ * buffer, which may then be smaller than requested.
+ */
+_SARG_INTERNAL char *_sarg_scratch(sarg_root *root, const size_t len, size_t *cap)
+{
+    if(root->flags & SARG_ROOT_STATIC) {
+        *cap = root->str_len - root->str_off;
+        return *cap > 0 ? &root->str_buf[root->str_off] : NULL;
+    }
+
+#ifndef SARG_NO_MALLOC
+    char *scratch;
+
+    if(root->scratch_len < len) {
+        scratch = (char *) _sarg_realloc(root, root->scratch, len);
+        if(!scratch)
+            return NULL;
+        root->scratch = scratch;
+        root->scratch_len = len;
+    }
+    *cap = root->scratch_len;
+
+    return root->scratch;
+#else
+    _SARG_UNUSED(len);
+    *cap = 0;
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Parses the arguments contained in the given command line.
+ *
+ * The command line is split like a POSIX shell would do it: arguments
+ * are separated by whitespace, single quotes preserve everything up to
+ * the next single quote, and within double quotes a backslash only
+ * escapes "$`\ and newlines. Outside of quotes a backslash escapes
+ * any character. Quoted and unquoted parts of one argument are joined.
+ * No expansion of variables, globs or comments takes place.
+ *
+ * In contrast to sarg_parse the command line does not start with the
+ * program name. Arguments without quotes or escapes are passed on
+ * directly, the others are unescaped into one scratch buffer that is
+ * kept by the root. Static roots use the unused part of their string
+ * buffer for this.
+ *
+ * On failure the offset of the argument that caused the error within
+ * cmdline is stored in root->err_idx, otherwise it is set to -1.
+ * Afterwards the rules of sarg_add_rule are checked, see sarg_check.
+ *
+ * @param root root object which should be used to parse arguments
+ * @param cmdline command line, which does not need to be NUL-terminated
+ * @param len length of cmdline
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_string_n(sarg_root *root, const char *cmdline,
+                         const size_t len)
+{
+    size_t pos, start, opt_pos, out, cap;
+    _sarg_parse_ctx ctx;
+    _sarg_token tok;
+    char *scratch;
+    char quote, c;
+    int ret;
+
+    root->err_idx = -1;
+    ctx.pending = -1;
+    ctx.rest = 0;
+    ctx.depth = 0;
+    pos = 0;
+    start = 0;
+    opt_pos = 0;
+    cap = 0;
+
+    while(1) {
+        while(pos < len && _SARG_IS_SPACE(cmdline[pos]))
+            ++pos;
+        if(pos >= len)
+            break;
+
+        start = pos;
+        scratch = NULL;
+        quote = '\0';
+        out = 0;
+        for(; pos < len; ++pos) {
+            c = cmdline[pos];
+            if(quote == '\0' && _SARG_IS_SPACE(c))
+                break;
+
+            if(!scratch) {
+                if(c != '\\' && c != '"' && c != '\'')
+                    continue;
+                // the argument differs from its input from here on
+                out = pos - start;
+                scratch = _sarg_scratch(root, len - start + 1, &cap);
+                if(!scratch || cap < out + 1) {
+                    ret = SARG_ERR_ALLOC;
+                    goto _sarg_parse_string_exit;
+                }
+                memcpy(scratch, &cmdline[start], out);
+            }
+
+            if(quote == '\'') {
+                if(c == '\'') {
+                    quote = '\0';
+                    continue;
+                }
+            } else if(c == '\\') {
+                if(pos + 1 >= len) {
+                    ret = SARG_ERR_PARSE;
+                    goto _sarg_parse_string_exit;
+                }
+                if(quote == '\0' || strchr("$`\"\\\n", cmdline[pos + 1])) {
+                    c = cmdline[++pos];
+                    // escaped newlines continue the line
+                    if(c == '\n')
+                        continue;
+                }
+            } else if(c == '"' || (c == '\'' && quote == '\0')) {
+                quote = quote == '\0' ? c : '\0';
+                continue;
+            }
+
+            if(out + 1 >= cap) {
+                ret = SARG_ERR_ALLOC;
+                goto _sarg_parse_string_exit;
+            }
+            scratch[out++] = c;
+        }
+
+        if(quote != '\0') {
+            ret = SARG_ERR_PARSE;
+            goto _sarg_parse_string_exit;
+        }
+        if(!scratch) {
+            scratch = (char *) &cmdline[start];
+            out = pos - start;
+        }
+
+        _sarg_lex(scratch, out, &tok);
+
+#ifndef SARG_NO_MALLOC
+        if(ctx.pending < 0 && !ctx.rest && root->cmd_len > 0 && out > 0
+           && tok.kind == _SARG_TOK_VALUE) {
+            // first positional argument selects the subcommand
+            ret = _sarg_find_cmd_n(root, scratch, out);
+            if(ret < 0) {
+                ret = SARG_ERR_NOTFOUND;
+                goto _sarg_parse_string_exit;
+            }
+
+            ret = _sarg_cmd_select(root, ret);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_parse_string_exit;
+
+            ret = sarg_parse_string_n(root->cmd_root, &cmdline[pos], len - pos);
+            if(ret != SARG_ERR_SUCCESS) {
+                if(root->cmd_root->err_idx >= 0)
+                    start = pos + root->cmd_root->err_idx;
+                goto _sarg_parse_string_exit;
+            }
+
+            return sarg_check(root);
+        }
+#endif
+
+        if(ctx.pending < 0)
+            opt_pos = start;
+
+        ret = _sarg_parse_token(root, &ctx, scratch, &tok);
+        if(ret != SARG_ERR_SUCCESS)
+            goto _sarg_parse_string_exit;
+    }
+
+    // last option is missing its value
+    if(ctx.pending >= 0) {
+        start = opt_pos;
+        ret = SARG_ERR_PARSE;
+        goto _sarg_parse_string_exit;
+    }
+
+    return sarg_check(root);
+
+_sarg_parse_string_exit:
+    root->err_idx = (int) start;
+    return ret;
+}
+
+/**
+ * @brief Parses the arguments contained in the given command line.
+ *
+ * Same as sarg_parse_string_n for a NUL-terminated command line.
+ *
+ * @param root root object which should be used to parse arguments
+ * @param cmdline NUL-terminated command line
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_string(sarg_root *root, const char *cmdline)
+{
+    return sarg_parse_string_n(root, cmdline, strlen(cmdline));
+}
+
+/* longest option name that is assembled from a section and a key */
+#define _SARG_MAX_KEY_LEN 255
+
+#define _SARG_IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+
+/**
+ * Sets the option of the given name to a value read from a
+ * configuration file. BOOL options are set to the given value instead
+ * of being toggled and may omit it to be set to true. arg is NULL if
+ * no value was given.
+ */
+_SARG_INTERNAL int _sarg_apply_key(sarg_root *root, const char *name, const int len,
+                                   const char *arg, const int arg_len)
+{
+    int idx;
+
+    idx = _sarg_find_opt_n(root, name, len);
+    if(idx < 0)
+        return SARG_ERR_NOTFOUND;
+
+    return _sarg_apply_set(root, idx, arg, arg_len);
+}
+
+/**
+ * Parses a single line of an INI file, which ranges from begin to end.
+ * A section header replaces the current section, which is kept as a
+ * span into the buffer.
+ */
+_SARG_INTERNAL int _sarg_parse_ini_line(sarg_root *root, const char *begin, const char *end,
+                                        const char **sec, int *sec_len)
+{
+    char name[_SARG_MAX_KEY_LEN + 1];
+    const char *key, *key_end, *val, *val_end;
+    char quote;
+
+    while(begin < end && _SARG_IS_BLANK(*begin))
+        ++begin;
+    while(end > begin && _SARG_IS_BLANK(end[-1]))
+        --end;
+    if(begin == end || *begin == '#' || *begin == ';')
+        return SARG_ERR_SUCCESS;
+
+    if(*begin == '[') {
+        if(end[-1] != ']' || end - begin < 2)
+            return SARG_ERR_PARSE;
+        ++begin;
+        --end;
+        while(begin < end && _SARG_IS_BLANK(*begin))
+            ++begin;
+        while(end > begin && _SARG_IS_BLANK(end[-1]))
+            --end;
+        *sec = begin;
+        *sec_len = end - begin;
+        return SARG_ERR_SUCCESS;
+    }
+
+    key = begin;
+    key_end = (const char *) memchr(begin, '=', end - begin);
+    val = NULL;
+    val_end = NULL;
+    if(key_end) {
+        val = key_end + 1;
+        val_end = end;
+    } else {
+        key_end = end;
+    }
+    while(key_end > key && _SARG_IS_BLANK(key_end[-1]))
+        --key_end;
+    if(key_end == key)
+        return SARG_ERR_PARSE;
+
+    if(val) {
+        while(val < val_end && _SARG_IS_BLANK(*val))
+            ++val;
+
+        if(val < val_end && (*val == '"' || *val == '\'')) {
+            // quoted values keep whitespace and comment chars
+            quote = *val++;
+            end = val;
+            while(end < val_end && *end != quote)
+                ++end;
+            if(end >= val_end)
+                return SARG_ERR_PARSE;
+            for(begin = end + 1; begin < val_end && _SARG_IS_BLANK(*begin); ++begin);
+            if(begin < val_end && *begin != '#' && *begin != ';')
+                return SARG_ERR_PARSE;
+            val_end = end;
+        } else {
+            // comments have to be separated from the value
+            for(end = val; end < val_end; ++end) {
+                if((*end == '#' || *end == ';')
+                   && (end == val || _SARG_IS_BLANK(end[-1])))
+                    break;
+            }
+            val_end = end;
+            while(val_end > val && _SARG_IS_BLANK(val_end[-1]))
+                --val_end;
+        }
+    }
+
+    if(*sec_len > 0) {
+        if(*sec_len + 1 + (key_end - key) > _SARG_MAX_KEY_LEN)
+            return SARG_ERR_NOTFOUND;
+        memcpy(name, *sec, *sec_len);
+        name[*sec_len] = '.';
+        memcpy(&name[*sec_len + 1], key, key_end - key);
+        return _sarg_apply_key(root, name, *sec_len + 1 + (key_end - key),
+                               val, val_end - val);
+    }
+
+    return _sarg_apply_key(root, key, key_end - key, val, val_end - val);
+}
+
+/**
+ * @brief Parses options from a buffer in INI format.
+ *
+ * Every line holds a "key = value" pair, a "[section]" header or a
+ * comment starting with '#' or ';'. Keys within a section are looked up
+ * as "section.key", keys before the first section or after an empty
+ * "[]" header as they are. Values may be quoted with single or double
+ * quotes to keep surrounding whitespace and comment characters, escapes
+ * are not interpreted. Unquoted values end at a comment that is
+ * separated by whitespace.
+ *
+ * BOOL options take one of true, yes, on, 1, false, no, off or 0 and
+ * are set to true if the value is omitted. All other values are
+ * converted and passed to callbacks like in sarg_parse.
+ *
+ * The buffer is read in a single pass and nothing is copied or
+ * allocated except for string values. It does not need to be
+ * NUL-terminated.
+ *
+ * On failure the line number of the offending line, starting at 1, is
+ * stored in root->err_idx, otherwise it is set to -1.
+ *
+ * @param root root object which should be used to parse options
+ * @param buf buffer holding the INI text
+ * @param len length of buf in bytes
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_ini(sarg_root *root, const char *buf, const size_t len)
+{
+    const char *line, *eol, *end, *sec;
+    int lineno, sec_len, ret;
+
+    root->err_idx = -1;
+    if(len == 0)
+        return SARG_ERR_SUCCESS;
+
+    sec = NULL;
+    sec_len = 0;
+    lineno = 0;
+    line = buf;
+    end = buf + len;
+
+    while(line < end) {
+        ++lineno;
+        eol = (const char *) memchr(line, '\n', end - line);
+        if(!eol)
+            eol = end;
+
+        ret = _sarg_parse_ini_line(root, line, eol, &sec, &sec_len);
+        if(ret != SARG_ERR_SUCCESS) {
+            root->err_idx = lineno;
+            return ret;
+        }
+
+        line = eol + 1;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+#ifndef SARG_MAX_JSON_DEPTH
+#define SARG_MAX_JSON_DEPTH 32
+#endif
+
+typedef struct _sarg_json_ctx {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    // dotted path of the current key
+    char path[_SARG_MAX_KEY_LEN + 1];
+    int path_len;
+} _sarg_json_ctx;
+
+_SARG_INTERNAL void _sarg_json_skip_space(_sarg_json_ctx *ctx)
+{
+    while(ctx->pos < ctx->len && _SARG_IS_SPACE(ctx->buf[ctx->pos]))
+        ++ctx->pos;
+}
+
+/**
+ * Reads the four hex digits of a \u escape.
+ */
+_SARG_INTERNAL int _sarg_json_hex(_sarg_json_ctx *ctx, unsigned long *code)
+{
+    int i;
+    char c;
+
+    if(ctx->len - ctx->pos < 4)
+        return SARG_ERR_PARSE;
+
+    *code = 0;
+    for(i = 0; i < 4; ++i) {
+        c = ctx->buf[ctx->pos++];
+        *code <<= 4;
+        if(c >= '0' && c <= '9')
+            *code |= c - '0';
+        else if(c >= 'a' && c <= 'f')
+            *code |= c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            *code |= c - 'A' + 10;
+        else
+            return SARG_ERR_PARSE;
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Decodes an escape sequence after the backslash into out, which has
+ * room for at least 4 bytes. Returns the number of bytes written or a
+ * SARG_ERR_* code.
+ */
+_SARG_INTERNAL int _sarg_json_escape(_sarg_json_ctx *ctx, char *out)
+{
+    unsigned long code, low;
+    int ret;
+
+    if(ctx->pos >= ctx->len)
+        return SARG_ERR_PARSE;
+
+    switch(ctx->buf[ctx->pos++]) {
+    case '"': *out = '"'; return 1;
+    case '\\': *out = '\\'; return 1;
+    case '/': *out = '/'; return 1;
+    case 'b': *out = '\b'; return 1;
+    case 'f': *out = '\f'; return 1;
+    case 'n': *out = '\n'; return 1;
+    case 'r': *out = '\r'; return 1;
+    case 't': *out = '\t'; return 1;
+    case 'u':
+        break;
+    default:
+        return SARG_ERR_PARSE;
+    }
+
+    ret = _sarg_json_hex(ctx, &code);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    // surrogate pairs encode code points beyond the basic plane
+    if(code >= 0xD800 && code <= 0xDBFF) {
+        if(ctx->len - ctx->pos < 2 || ctx->buf[ctx->pos] != '\\'
+           || ctx->buf[ctx->pos + 1] != 'u')
+            return SARG_ERR_PARSE;
+        ctx->pos += 2;
+        ret = _sarg_json_hex(ctx, &low);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+        if(low < 0xDC00 || low > 0xDFFF)
+            return SARG_ERR_PARSE;
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    } else if(code >= 0xDC00 && code <= 0xDFFF) {
+        return SARG_ERR_PARSE;
+    }
+
+    // encode as UTF-8
+    if(code < 0x80) {
+        out[0] = (char) code;
+        return 1;
+    }
+    if(code < 0x800) {
+        out[0] = (char) (0xC0 | (code >> 6));
+        out[1] = (char) (0x80 | (code & 0x3F));
+        return 2;
+    }
+    if(code < 0x10000) {
+        out[0] = (char) (0xE0 | (code >> 12));
+        out[1] = (char) (0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char) (0xF0 | (code >> 18));
+    out[1] = (char) (0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char) (0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char) (0x80 | (code & 0x3F));
+    return 4;
+}
+
+/**
+ * Reads the string at the current position. If out is given, the
+ * string is decoded into it, which holds cap bytes. Otherwise strings
+ * without escapes are returned as span into the buffer and the others
+ * are decoded into the scratch buffer of the root.
+ */
+_SARG_INTERNAL int _sarg_json_string(sarg_root *root, _sarg_json_ctx *ctx, char *out,
+                                     size_t cap, const char **str, int *len)
+{
+    size_t start, end, n;
+    char c;
+    int ret;
+
+    start = ++ctx->pos;
+    while(ctx->pos < ctx->len) {
+        c = ctx->buf[ctx->pos];
+        if(c == '"' || c == '\\' || (unsigned char) c < 0x20)
+            break;
+        ++ctx->pos;
+    }
+    if(ctx->pos >= ctx->len || (unsigned char) ctx->buf[ctx->pos] < 0x20)
+        return SARG_ERR_PARSE;
+
+    if(!out) {
+        if(ctx->buf[ctx->pos] == '"') {
+            *str = &ctx->buf[start];
+            *len = ctx->pos - start;
+            ++ctx->pos;
+            return SARG_ERR_SUCCESS;
+        }
+
+        // decoding never makes a string longer
+        for(end = ctx->pos; end < ctx->len && ctx->buf[end] != '"'; ++end) {
+            if(ctx->buf[end] == '\\')
+                ++end;
+        }
+        out = _sarg_scratch(root, end - start + 4, &cap);
+    }
+
+    // decode everything from the start of the string
+    n = ctx->pos - start;
+    if(!out || n >= cap)
+        return SARG_ERR_ALLOC;
+    memcpy(out, &ctx->buf[start], n);
+
+    while(ctx->pos < ctx->len) {
+        c = ctx->buf[ctx->pos];
+        if(c == '"')
+            break;
+        if((unsigned char) c < 0x20)
+            return SARG_ERR_PARSE;
+        if(n + 4 >= cap)
+            return SARG_ERR_ALLOC;
+
+        ++ctx->pos;
+        if(c != '\\') {
+            out[n++] = c;
+            continue;
+        }
+        ret = _sarg_json_escape(ctx, &out[n]);
+        if(ret < 0)
+            return ret;
+        n += ret;
+    }
+    if(ctx->pos >= ctx->len)
+        return SARG_ERR_PARSE;
+
+    ++ctx->pos;
+    *str = out;
+    *len = n;
+
+    return SARG_ERR_SUCCESS;
+}
+
+_SARG_INTERNAL int _sarg_json_value(sarg_root *root, _sarg_json_ctx *ctx, const int depth,
+                                    const int in_array);
+
+/**
+ * Parses the object at the current position. Every key is appended to
+ * the path of the enclosing object, separated by a dot.
+ */
+_SARG_INTERNAL int _sarg_json_object(sarg_root *root, _sarg_json_ctx *ctx, const int depth)
+{
+    const char *key;
+    int path_len, key_len, ret;
+
+    path_len = ctx->path_len;
+    ++ctx->pos;
+    _sarg_json_skip_space(ctx);
+    if(ctx->pos < ctx->len && ctx->buf[ctx->pos] == '}') {
+        ++ctx->pos;
+        return SARG_ERR_SUCCESS;
+    }
+
+    while(1) {
+        _sarg_json_skip_space(ctx);
+        if(ctx->pos >= ctx->len || ctx->buf[ctx->pos] != '"')
+            return SARG_ERR_PARSE;
+
+        // keys that are too long cannot name any option
+        if(path_len + 1 >= _SARG_MAX_KEY_LEN)
+            return SARG_ERR_NOTFOUND;
+        ctx->path_len = path_len;
+        if(path_len > 0)
+            ctx->path[ctx->path_len++] = '.';
+        ret = _sarg_json_string(root, ctx, &ctx->path[ctx->path_len],
+                                _SARG_MAX_KEY_LEN - ctx->path_len,
+                                &key, &key_len);
+        if(ret == SARG_ERR_ALLOC)
+            ret = SARG_ERR_NOTFOUND;
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+        ctx->path_len += key_len;
+
+        _sarg_json_skip_space(ctx);
+        if(ctx->pos >= ctx->len || ctx->buf[ctx->pos] != ':')
+            return SARG_ERR_PARSE;
+        ++ctx->pos;
+
+        ret = _sarg_json_value(root, ctx, depth, 0);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+
+        _sarg_json_skip_space(ctx);
+        if(ctx->pos >= ctx->len)
+            return SARG_ERR_PARSE;
+        if(ctx->buf[ctx->pos] == '}')
+            break;
+        if(ctx->buf[ctx->pos] != ',')
+            return SARG_ERR_PARSE;
+        ++ctx->pos;
+    }
+
+    ++ctx->pos;
+    ctx->path_len = path_len;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Returns the length of the JSON number at the start of val, which is
+ * at most len bytes long, or 0 if it does not start with a number.
+ */
+_SARG_INTERNAL int _sarg_json_number(const char *val, const int len)
+{
+    int i = 0, digits;
+
+    if(i < len && val[i] == '-')
+        ++i;
+    if(i < len && val[i] == '0')
+        ++i;
+    else if(i < len && val[i] >= '1' && val[i] <= '9')
+        while(i < len && _SARG_IS_DIGIT(val[i]))
+            ++i;
+    else
+        return 0;
+
+    if(i < len && val[i] == '.') {
+        for(++i, digits = 0; i < len && _SARG_IS_DIGIT(val[i]); ++i)
+            ++digits;
+        if(digits == 0)
+            return 0;
+    }
+    if(i < len && (val[i] == 'e' || val[i] == 'E')) {
+        ++i;
+        if(i < len && (val[i] == '+' || val[i] == '-'))
+            ++i;
+        for(digits = 0; i < len && _SARG_IS_DIGIT(val[i]); ++i)
+            ++digits;
+        if(digits == 0)
+            return 0;
+    }
+
+    return i;
+}
+
+/**
+ * Parses the array at the current position. Each element is applied
+ * to the option of the current path in turn, like a repeated option.
+ */
+_SARG_INTERNAL int _sarg_json_array(sarg_root *root, _sarg_json_ctx *ctx, const int depth)
+{
+    int ret;
+
+    ++ctx->pos;
+    _sarg_json_skip_space(ctx);
+    if(ctx->pos < ctx->len && ctx->buf[ctx->pos] == ']') {
+        ++ctx->pos;
+        return SARG_ERR_SUCCESS;
+    }
+
+    while(1) {
+        ret = _sarg_json_value(root, ctx, depth, 1);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+
+        _sarg_json_skip_space(ctx);
+        if(ctx->pos >= ctx->len)
+            return SARG_ERR_PARSE;
+        if(ctx->buf[ctx->pos] == ']')
+            break;
+        if(ctx->buf[ctx->pos] != ',')
+            return SARG_ERR_PARSE;
+        ++ctx->pos;
+    }
+
+    ++ctx->pos;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Parses the value at the current position and applies scalars to the
+ * option named by the current path. Elements of an array have to be
+ * scalars.
+ */
+_SARG_INTERNAL int _sarg_json_value(sarg_root *root, _sarg_json_ctx *ctx, const int depth,
+                                    const int in_array)
+{
+    const char *val;
+    size_t start;
+    int val_len, ret;
+
+    _sarg_json_skip_space(ctx);
+    if(ctx->pos >= ctx->len)
+        return SARG_ERR_PARSE;
+
+    start = ctx->pos;
+    switch(ctx->buf[ctx->pos]) {
+    case '{':
+        if(in_array)
+            return SARG_ERR_PARSE;
+        if(depth >= SARG_MAX_JSON_DEPTH)
+            return SARG_ERR_RECURSION;
+        return _sarg_json_object(root, ctx, depth + 1);
+    case '[':
+        if(in_array)
+            return SARG_ERR_PARSE;
+        return _sarg_json_array(root, ctx, depth);
+    case '"':
+        ret = _sarg_json_string(root, ctx, NULL, 0, &val, &val_len);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+        break;
+    default:
+        // numbers and literals end at the next delimiter
+        while(ctx->pos < ctx->len && !_SARG_IS_SPACE(ctx->buf[ctx->pos])
+              && ctx->buf[ctx->pos] != ',' && ctx->buf[ctx->pos] != '}'
+              && ctx->buf[ctx->pos] != ']')
+            ++ctx->pos;
+        val = &ctx->buf[start];
+        val_len = ctx->pos - start;
+        if(_sarg_name_cmp("null", val, val_len) == 0)
+            return SARG_ERR_SUCCESS;
+        if(_sarg_name_cmp("true", val, val_len) != 0
+           && _sarg_name_cmp("false", val, val_len) != 0
+           && _sarg_json_number(val, val_len) != val_len) {
+            ctx->pos = start;
+            return SARG_ERR_PARSE;
+        }
+        break;
+    }
+
+    ret = _sarg_apply_key(root, ctx->path, ctx->path_len, val, val_len);
+    // report the start of the value
+    if(ret != SARG_ERR_SUCCESS)
+        ctx->pos = start;
+
+    return ret;
+}
+
+/**
+ * @brief Parses options from a buffer holding a JSON object.
+ *
+ * Keys of nested objects are joined with dots, so the value of "port"
+ * in {"server": {"port": 80}} is applied to the option "server.port".
+ * Strings, numbers and the literals true and false are converted like
+ * the arguments of sarg_parse, null values are ignored. Any other
+ * unquoted token is rejected. The elements of an array are applied in
+ * order as if the option was repeated on the command line, so counts
+ * and callbacks behave the same. Arrays hold scalars only.
+ *
+ * The buffer is read in a single pass without building a document, so
+ * memory use does not depend on its size. Only strings with escapes
+ * are decoded into the scratch buffer of the root. Objects may be
+ * nested SARG_MAX_JSON_DEPTH levels deep.
+ *
+ * On failure the offset of the offending value or character is stored
+ * in root->err_idx, otherwise it is set to -1.
+ *
+ * @param root root object which should be used to parse options
+ * @param buf buffer holding the JSON text, not necessarily terminated
+ * @param len length of buf in bytes
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_json(sarg_root *root, const char *buf, const size_t len)
+{
+    _sarg_json_ctx ctx;
+    int ret;
+
+    root->err_idx = -1;
+    ctx.buf = buf;
+    ctx.len = len;
+    ctx.pos = 0;
+    ctx.path_len = 0;
+
+    _sarg_json_skip_space(&ctx);
+    if(ctx.pos >= ctx.len || buf[ctx.pos] != '{') {
+        ret = SARG_ERR_PARSE;
+        goto _sarg_parse_json_exit;
+    }
+
+    ret = _sarg_json_object(root, &ctx, 1);
+    if(ret != SARG_ERR_SUCCESS)
+        goto _sarg_parse_json_exit;
+
+    _sarg_json_skip_space(&ctx);
+    if(ctx.pos < ctx.len) {
+        ret = SARG_ERR_PARSE;
+        goto _sarg_parse_json_exit;
+    }
+
+    return SARG_ERR_SUCCESS;
+
+_sarg_parse_json_exit:
+    root->err_idx = (int) ctx.pos;
+    return ret;
+}
+
+/**
+ * @brief Access the parsing result of the specified option.
+ *
+ * @param root root object that was used to parse arguments
+ * @param name short or long name of the option
+ * @param res result object for the given option
+ *
+ * @return SARG_ERR_SUCCESS on success or SARG_ERR_NOTFOUND if the option was not found
+ */
+int sarg_get(sarg_root *root, const char *name, sarg_result **res)
+{
+    return sarg_get_n(root, name, strlen(name), res);
+}
+
+/**
+ * @brief Access the parsing result of the option with a name of the given length.
+ *
+ * @param root root object that was used to parse arguments
+ * @param name short or long name of the option, which does not need to
+ *             be NUL-terminated
+ * @param len length of name
+ * @param res result object for the given option
+ *
+ * @return SARG_ERR_SUCCESS on success or SARG_ERR_NOTFOUND if the option was not found
+ */
+int sarg_get_n(sarg_root *root, const char *name, const int len,
+               sarg_result **res)
+{
+    int arg_idx, dashes;
+
+    for(dashes = 0; dashes < len && name[dashes] == '-'; ++dashes);
+
+    arg_idx = _sarg_find_opt_n(root, &name[dashes], len - dashes);
+    if(arg_idx < 0)
+        return SARG_ERR_NOTFOUND;
+
+    *res = &root->results[arg_idx];
+
+    return SARG_ERR_SUCCESS;
+}
+
+#ifndef SARG_NO_PRINT
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+/**
+ * Doubles the size of a buffer, which was allocated with the allocator
+ * of the given root.
+ */
+_SARG_INTERNAL int _sarg_buf_resize(sarg_root *root, char **buf, int *len)
+{
+#ifdef SARG_NO_MALLOC
+    _SARG_UNUSED(root);
+    _SARG_UNUSED(buf);
+    _SARG_UNUSED(len);
+    return SARG_ERR_ALLOC;
+#else
+    char *buf_tmp;
+
+    buf_tmp = (char *) _sarg_realloc(root, *buf, 2 * *len);
+    if(!buf_tmp)
+        return SARG_ERR_ALLOC;
+
+    *buf = buf_tmp;
+    *len = 2 * *len;
+
+    return SARG_ERR_SUCCESS;
+#endif
+}
+
+_SARG_INTERNAL int _sarg_snprintf(sarg_root *root, char **buf, int *len, int *off,
+                                  const char *fmt, ...)
+{
+    va_list args;
+    int ret, write_len;
+    char *curr_ptr;
+
+    while(1) {
+        write_len = *len - *off;
+        curr_ptr = &((*buf)[*off]);
+
+        va_start(args, fmt);
+
+        ret = vsnprintf(curr_ptr, write_len, fmt, args);
+
+        va_end(args);
+
+        if(ret < 0)
+            return SARG_ERR_OTHER;
+
+        if(ret < write_len) {
+            *off += ret;
+            break;
+        }
+
+        ret = _sarg_buf_resize(root, buf, len);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
+    }
+
+
+    return SARG_ERR_SUCCESS;
+}
+
+static const char *_sarg_opt_type_str[COUNT] = {
+    "INT",
+    "UINT",
+    "DOUBLE",
+    "",
+    "STRING",
+    "ENUM",
+    "SIZE",
+    "DURATION"
+};
+
+/* units accepted by SIZE and DURATION options, see _sarg_parse_size */
+static const char *_sarg_opt_unit_str[COUNT] = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    "B|k|M|G|T|P|E|Ki|Mi|Gi|Ti|Pi|Ei",
+    "ns|us|ms|s|m|h|d"
+};
+
+/**
+ * Prints the help text of root into a buffer, which is allocated with
+ * the allocator of mem and accounted to it.
+ */
+_SARG_INTERNAL int _sarg_help_text(sarg_root *root, sarg_root *mem, char **outbuf)
+{
+    int outlen, i, j, offset, linestart, ret;
+    const char *type_name;
+    *outbuf = NULL;
+
+#ifdef SARG_NO_MALLOC
+    outlen = root->help_len;
+    *outbuf = root->help_buf;
+#else
+    outlen = 256;
+    *outbuf = (char *) _sarg_malloc(mem, outlen);
+#endif
+    if(!*outbuf || outlen <= 0)
+        return SARG_ERR_ALLOC;
+
+    offset = 0;
+    ret = _sarg_snprintf(mem, outbuf, &outlen, &offset,
+                         "Usage: %s [OPTION]... %s[ARG]...\n\n", root->name,
+                         root->cmd_len > 0 ? "COMMAND " : "");
+    if(ret != SARG_ERR_SUCCESS)
+        goto _sarg_help_text_exit;
+
+    for(i = 0; i < root->opt_len; ++i) {
+        linestart = offset;
+        type_name = _sarg_opt_type_str[root->opts[i].type];
+        // create output depending on which options are available
+        if(root->opts[i].short_name && root->opts[i].long_name) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "  -%s, --%s %s",
+                                 root->opts[i].short_name, root->opts[i].long_name, type_name);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        } else if(root->opts[i].short_name) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "  -%s %s",
+                                 root->opts[i].short_name, type_name);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        } else if(root->opts[i].long_name) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "  --%s %s",
+                                 root->opts[i].long_name, type_name);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        }
+
+        // pad options string to align help texts
+        if(offset - linestart < 30) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "%*s",
+                                 30 - (offset - linestart), "");
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        }
+
+        if(root->opts[i].help) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "%s", root->opts[i].help);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        }
+
+        if(_sarg_opt_unit_str[root->opts[i].type]) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "%s{%s}",
+                                 root->opts[i].help ? " " : "",
+                                 _sarg_opt_unit_str[root->opts[i].type]);
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        }
+
+        // list the allowed values of ENUM options
+        for(j = 0; root->choices && j < root->choices[i].len; ++j) {
+            ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "%s%s%s",
+                                 j == 0 ? (root->opts[i].help ? " {" : "{") : "|",
+                                 root->choices[i].names[j],
+                                 j == root->choices[i].len - 1 ? "}" : "");
+            if(ret != SARG_ERR_SUCCESS)
+                goto _sarg_help_text_exit;
+        }
+
+        ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "\n");
+        if(ret != SARG_ERR_SUCCESS)
+            goto _sarg_help_text_exit;
+    }
+
+    if(root->cmd_len > 0) {
+        ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "\nCommands:\n");
+        if(ret != SARG_ERR_SUCCESS)
+            goto _sarg_help_text_exit;
+    }
+
+    for(i = 0; i < root->cmd_len; ++i) {
+        ret = _sarg_snprintf(mem, outbuf, &outlen, &offset, "  %-28s%s\n",
+                             root->cmds[i].name,
+                             root->cmds[i].help ? root->cmds[i].help : "");
+        if(ret != SARG_ERR_SUCCESS)
+            goto _sarg_help_text_exit;
+    }
+
+    return SARG_ERR_SUCCESS;
+
+_sarg_help_text_exit:
+#ifndef SARG_NO_MALLOC
+    _sarg_free(mem, *outbuf);
+#endif
+    *outbuf = NULL;
+    return ret;
+}
+
+/**
+ * @brief Prints a help text into the given buffer.
+ *
+ * The root object has to be initialized with sarg_init before
+ * being passed to this function.
+ *
+ * This function allocates the buffer with the allocator of the root,
+ * so that the help text fits into the buffer. outbuf has to be
+ * released with sarg_free_text afterwards and counts towards
+ * sarg_memory_usage until then.
+ *
+ * If SARG_NO_MALLOC is defined, the help text is written into the
+ * help buffer of a static root instead. outbuf then points into this
+ * buffer and must not be freed. SARG_ERR_ALLOC is returned if the
+ * text does not fit.
+ *
+ * @param root root object for creating help text
+ * @param outbuf dynamically allocated output buffer for help text
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_help_text(sarg_root *root, char **outbuf)
+{
+    return _sarg_help_text(root, root, outbuf);
+}
+
+/**
+ * @brief Prints a help text to stdout.
+ *
+ * @param root root object for creating help text
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_help_print(sarg_root *root)
+{
+    char *buf;
+    int ret;
+
+    ret = sarg_help_text(root, &buf);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+    printf("%s", buf);
+    sarg_free_text(root, buf);
+
+    return SARG_ERR_SUCCESS;
+}
+
+#define _SARG_WRITER_SIZE 4096
+
+typedef struct _sarg_writer {
+    sarg_write_cb write;
+    void *ctx;
+    size_t len;
+    int err;
+    char buf[_SARG_WRITER_SIZE];
+} _sarg_writer;
+
+_SARG_INTERNAL void _sarg_writer_flush(_sarg_writer *w)
+{
+    if(w->len > 0 && w->err == SARG_ERR_SUCCESS)
+        w->err = w->write(w->ctx, w->buf, w->len);
+    w->len = 0;
+}
+
+_SARG_INTERNAL void _sarg_writer_put(_sarg_writer *w, const char *data, const size_t len)
+{
+    if(w->len + len > _SARG_WRITER_SIZE)
+        _sarg_writer_flush(w);
+    if(w->err != SARG_ERR_SUCCESS)
+        return;
+
+    // large chunks bypass the buffer
+    if(len >= _SARG_WRITER_SIZE) {
+        w->err = w->write(w->ctx, data, len);
+        return;
+    }
+
+    memcpy(&w->buf[w->len], data, len);
+    w->len += len;
+}
+
+_SARG_INTERNAL void _sarg_writer_str(_sarg_writer *w, const char *str)
+{
+    _sarg_writer_put(w, str, strlen(str));
+}
+
+/**
+ * Writes the decimal digits of an unsigned number, which avoids the
+ * format string parsing of printf.
+ */
+_SARG_INTERNAL void _sarg_writer_uint(_sarg_writer *w, uint64_t val, const int neg)
+{
+    char digits[24];
+    int pos;
+
+    pos = sizeof(digits);
+    do {
+        digits[--pos] = (char) ('0' + val % 10);
+        val /= 10;
+    } while(val > 0);
+    if(neg)
+        digits[--pos] = '-';
+
+    _sarg_writer_put(w, &digits[pos], sizeof(digits) - pos);
+}
+
+_SARG_INTERNAL void _sarg_writer_int(_sarg_writer *w, const long val)
+{
+    if(val < 0)
+        _sarg_writer_uint(w, 0UL - (unsigned long) val, 1);
+    else
+        _sarg_writer_uint(w, (unsigned long) val, 0);
+}
+
+/**
+ * Writes the first of 15, 16 or 17 significant digits that reads back
+ * as the same double, with a dot as decimal point regardless of the
+ * locale. Returns 0 if the value is not finite.
+ */
+_SARG_INTERNAL int _sarg_writer_double(_sarg_writer *w, const double val)
+{
+    char num[32];
+    int prec, i, j;
+
+    // NaN and infinities have no JSON representation
+    if(val != val || val - val != 0)
+        return 0;
+
+    // shortest precision which reads back to the same value
+    for(prec = 15; prec <= 17; ++prec) {
+        snprintf(num, sizeof(num), "%.*g", prec, val);
+        if(strtod(num, NULL) == val)
+            break;
+    }
+
+    // the decimal point depends on the locale, write it as a dot
+    for(i = 0, j = 0; num[i]; ++i) {
+        if(_SARG_IS_DIGIT(num[i]) || strchr("+-eE", num[i]) != NULL)
+            num[j++] = num[i];
+        else if(j == 0 || num[j - 1] != '.')
+            num[j++] = '.';
+    }
+    _sarg_writer_put(w, num, j);
+
+    return 1;
+}
+
+/**
+ * Writes a quoted JSON string. Runs of characters which need no escape
+ * are copied at once.
+ */
+_SARG_INTERNAL void _sarg_writer_json_str(_sarg_writer *w, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run;
+    char esc[6];
+    unsigned char c;
+
+    _sarg_writer_put(w, "\"", 1);
+    for(run = str; *str; ++str) {
+        c = (unsigned char) *str;
+        if(c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        _sarg_writer_put(w, run, str - run);
+        run = str + 1;
+        esc[0] = '\\';
+        switch(c) {
+        case '"': esc[1] = '"'; break;
+        case '\\': esc[1] = '\\'; break;
+        case '\n': esc[1] = 'n'; break;
+        case '\r': esc[1] = 'r'; break;
+        case '\t': esc[1] = 't'; break;
+        default:
+            memcpy(&esc[1], "u00", 3);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xF];
+            _sarg_writer_put(w, esc, 6);
+            continue;
+        }
+        _sarg_writer_put(w, esc, 2);
+    }
+    _sarg_writer_put(w, run, str - run);
+    _sarg_writer_put(w, "\"", 1);
+}
+
+/**
+ * Checks whether a string survives the line format of sarg_parse_file,
+ * which trims values and ends them at the line break.
+ */
+_SARG_INTERNAL int _sarg_args_str_valid(const char *str)
+{
+    size_t len = strlen(str);
+
+    if(len == 0 || isspace((unsigned char) str[0])
+       || isspace((unsigned char) str[len - 1]))
+        return 0;
+    return strchr(str, '\n') == NULL && strchr(str, '\r') == NULL;
+}
+
+/**
+ * @brief Writes the parsing results in a format that can be read again.
+ *
+ * With SARG_DUMP_JSON a compact JSON object is written, which maps the
+ * long name, or the short name if there is none, to the value of each
+ * option and can be read with sarg_parse_json. BOOL options are written
+ * as true or false, non-finite doubles as null.
+ *
+ * With SARG_DUMP_ARGS one "name value" line per option is written,
+ * which sarg_parse_file reads. BOOL options are only written if they
+ * are true. Strings that are empty, contain line breaks or start or
+ * end with whitespace cannot be written in this format and make the
+ * function fail with SARG_ERR_INVALARG.
+ *
+ * Only options which appeared while parsing are written unless
+ * SARG_DUMP_ALL is given. The output is collected in a buffer of
+ * _SARG_WRITER_SIZE bytes and passed to write in chunks. Numbers are
+ * formatted without printf, doubles with the shortest of 15 or 17
+ * significant digits that reads back exactly.
+ *
+ * @param root root object that was used to parse arguments
+ * @param format SARG_DUMP_JSON or SARG_DUMP_ARGS
+ * @param flags 0 or SARG_DUMP_ALL
+ * @param write function receiving the output, returns a SARG_ERR_* code
+ * @param ctx pointer passed to write
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_dump(sarg_root *root, const int format, const unsigned int flags,
+              sarg_write_cb write, void *ctx)
+{
+    _sarg_writer w;
+    const sarg_result *res;
+    const char *name, *choice;
+    int i, first;
+
+    if(format != SARG_DUMP_JSON && format != SARG_DUMP_ARGS)
+        return SARG_ERR_INVALARG;
+
+    w.write = write;
+    w.ctx = ctx;
+    w.len = 0;
+    w.err = SARG_ERR_SUCCESS;
+
+    first = 1;
+    if(format == SARG_DUMP_JSON)
+        _sarg_writer_put(&w, "{", 1);
+
+    for(i = 0; i < root->opt_len && w.err == SARG_ERR_SUCCESS; ++i) {
+        res = &root->results[i];
+        if(res->count == 0 && !(flags & SARG_DUMP_ALL))
+            continue;
+        name = root->opts[i].long_name ? root->opts[i].long_name
+                                       : root->opts[i].short_name;
+        // ENUM values are written by the name of their choice
+        choice = NULL;
+        if(res->type == ENUM && root->choices && res->int_val >= 0
+           && res->int_val < root->choices[i].len)
+            choice = root->choices[i].names[res->int_val];
+
+        if(format == SARG_DUMP_JSON) {
+            if(!first)
+                _sarg_writer_put(&w, ",", 1);
+            first = 0;
+            _sarg_writer_json_str(&w, name);
+            _sarg_writer_put(&w, ":", 1);
+
+            switch(res->type) {
+            case INT:
+                _sarg_writer_int(&w, res->int_val);
+                break;
+            case ENUM:
+                if(choice)
+                    _sarg_writer_json_str(&w, choice);
+                else
+                    _sarg_writer_int(&w, res->int_val);
+                break;
+            case UINT:
+                _sarg_writer_uint(&w, res->uint_val, 0);
+                break;
+            case SIZE:
+                _sarg_writer_uint(&w, res->size_val, 0);
+                break;
+            case DURATION:
+                // a number without unit would not read back
+                _sarg_writer_put(&w, "\"", 1);
+                _sarg_writer_uint(&w, res->duration_val, 0);
+                _sarg_writer_put(&w, "ns\"", 3);
+                break;
+            case DOUBLE:
+                if(!_sarg_writer_double(&w, res->double_val))
+                    _sarg_writer_str(&w, "null");
+                break;
+            case BOOL:
+                _sarg_writer_str(&w, res->bool_val ? "true" : "false");
+                break;
+            default:
+                if(res->str_val)
+                    _sarg_writer_json_str(&w, res->str_val);
+                else
+                    _sarg_writer_str(&w, "null");
+                break;
+            }
+            continue;
+        }
+
+        // options without value cannot be represented in an args file
+        if((res->type == BOOL && !res->bool_val)
+           || (res->type == STRING && !res->str_val))
+            continue;
+        if(res->type == STRING && !_sarg_args_str_valid(res->str_val))
+            return SARG_ERR_INVALARG;
+        if(choice && !_sarg_args_str_valid(choice))
+            return SARG_ERR_INVALARG;
+
+        _sarg_writer_str(&w, name);
+        switch(res->type) {
+        case INT:
+            _sarg_writer_put(&w, " ", 1);
+            _sarg_writer_int(&w, res->int_val);
+            break;
+        case ENUM:
+            _sarg_writer_put(&w, " ", 1);
+            if(choice)
+                _sarg_writer_str(&w, choice);
+            else
+                _sarg_writer_int(&w, res->int_val);
+            break;
+        case UINT:
+            _sarg_writer_put(&w, " ", 1);
+            _sarg_writer_uint(&w, res->uint_val, 0);
+            break;
+        case SIZE:
+            _sarg_writer_put(&w, " ", 1);
+            _sarg_writer_uint(&w, res->size_val, 0);
+            break;
+        case DURATION:
+            _sarg_writer_put(&w, " ", 1);
+            _sarg_writer_uint(&w, res->duration_val, 0);
+            _sarg_writer_put(&w, "ns", 2);
+            break;
+        case DOUBLE:
+            _sarg_writer_put(&w, " ", 1);
+            if(!_sarg_writer_double(&w, res->double_val)) {
+                if(res->double_val != res->double_val)
+                    _sarg_writer_str(&w, "nan");
+                else
+                    _sarg_writer_str(&w, res->double_val < 0 ? "-inf" : "inf");
+            }
+            break;
+        case BOOL:
+            break;
+        default:
+            _sarg_writer_put(&w, " ", 1);
+            _sarg_writer_str(&w, res->str_val);
+            break;
+        }
+        _sarg_writer_put(&w, "\n", 1);
+    }
+
+    if(format == SARG_DUMP_JSON)
+        _sarg_writer_put(&w, "}", 1);
+    _sarg_writer_flush(&w);
+
+    return w.err;
+}
+
+#ifndef SARG_NO_MALLOC
+
+typedef struct _sarg_text_sink {
+    sarg_root *root;
+    char *buf;
+    int len;
+    int off;
+} _sarg_text_sink;
+
+_SARG_INTERNAL int _sarg_text_write(void *ctx, const char *data, const size_t len)
+{
+    _sarg_text_sink *sink = (_sarg_text_sink *) ctx;
+    int ret;
 
-            // call callback if it was set
-            if(root->opts[arg_idx].callback) {
-                ret = root->opts[arg_idx].callback(&root->results[arg_idx]);
-                if(ret != SARG_ERR_SUCCESS)
-                    return ret;
-            }
-        }
+    while((size_t) (sink->len - sink->off) <= len) {
+        ret = _sarg_buf_resize(sink->root, &sink->buf, &sink->len);
+        if(ret != SARG_ERR_SUCCESS)
+            return ret;
     }
 
+    memcpy(&sink->buf[sink->off], data, len);
+    sink->off += len;
+    sink->buf[sink->off] = '\0';
+
     return SARG_ERR_SUCCESS;
 }
 
 /**
- * @brief Access the parsing result of the specified option.
+ * @brief Writes the parsing results into a newly allocated string.
+ *
+ * See sarg_dump for the formats. The string is allocated with the
+ * allocator of the root and has to be released with sarg_free_text
+ * afterwards.
  *
  * @param root root object that was used to parse arguments
- * @param name short or long name of the option
- * @param res result object for the given option
+ * @param format SARG_DUMP_JSON or SARG_DUMP_ARGS
+ * @param flags 0 or SARG_DUMP_ALL
+ * @param outbuf dynamically allocated output buffer
  *
- * @return SARG_ERR_SUCCESS on success or SARG_ERR_NOTFOUND if the option was not found
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
  */
-int sarg_get(sarg_root *root, const char *name, sarg_result **res)
+int sarg_dump_text(sarg_root *root, const int format,
+                   const unsigned int flags, char **outbuf)
 {
-    int arg_idx;
+    _sarg_text_sink sink;
+    int ret;
 
-    arg_idx = _sarg_find_opt(root, name);
-    if(arg_idx < 0)
-        return SARG_ERR_NOTFOUND;
+    *outbuf = NULL;
+    sink.root = root;
+    sink.len = 256;
+    sink.off = 0;
+    sink.buf = (char *) _sarg_malloc(root, sink.len);
+    if(!sink.buf)
+        return SARG_ERR_ALLOC;
+    sink.buf[0] = '\0';
 
-    *res = &root->results[arg_idx];
+    ret = sarg_dump(root, format, flags, _sarg_text_write, &sink);
+    if(ret != SARG_ERR_SUCCESS) {
+        _sarg_free(root, sink.buf);
+        return ret;
+    }
+
+    *outbuf = sink.buf;
 
     return SARG_ERR_SUCCESS;
 }
 
-#ifndef SARG_NO_PRINT
+#endif
 
-#include <stdarg.h>
-#include <stdio.h>
+#ifndef SARG_NO_FILE
 
-int _sarg_buf_resize(char **buf, int *len)
+_SARG_INTERNAL int _sarg_file_write(void *ctx, const char *data, const size_t len)
 {
-    char *buf_tmp = *buf;
-    int old_len = *len;
-
-    *buf = (char *) malloc(old_len * 2);
-    if(!*buf) {
-        *buf = buf_tmp;
-        return SARG_ERR_ALLOC;
-    }
-
-    memcpy(*buf, buf_tmp, old_len);
-    *len = 2 * old_len;
-
-    free(buf_tmp);
-
+    if(fwrite(data, 1, len, (FILE *) ctx) != len)
+        return SARG_ERR_ERRNO;
     return SARG_ERR_SUCCESS;
 }
 
-int _sarg_snprintf(char **buf, int *len, int *off, const char *fmt, ...)
+/**
+ * @brief Writes the parsing results into the given file.
+ *
+ * See sarg_dump for the formats. A file written with SARG_DUMP_ARGS
+ * can be read with sarg_parse_file, one written with SARG_DUMP_JSON
+ * with sarg_parse_json_file.
+ *
+ * @param root root object that was used to parse arguments
+ * @param format SARG_DUMP_JSON or SARG_DUMP_ARGS
+ * @param flags 0 or SARG_DUMP_ALL
+ * @param filename path of the file, which is overwritten
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_dump_file(sarg_root *root, const int format,
+                   const unsigned int flags, const char *filename)
 {
-    va_list args;
-    int ret, write_len;
-    char *curr_ptr;
-
-    while(1) {
-        write_len = *len - *off;
-        curr_ptr = &((*buf)[*off]);
-
-        va_start(args, fmt);
-
-        ret = vsnprintf(curr_ptr, write_len, fmt, args);
-
-        va_end(args);
-
-        if(ret < 0)
-            return SARG_ERR_OTHER;
-
-        if(ret < write_len) {
-            *off += ret;
-            break;
-        }
+    FILE *fp;
+    int ret;
 
-        ret = _sarg_buf_resize(buf, len);
-        if(ret != SARG_ERR_SUCCESS)
-            return ret;
-    }
+    fp = fopen(filename, "w");
+    if(!fp)
+        return SARG_ERR_ERRNO;
 
+    ret = sarg_dump(root, format, flags, _sarg_file_write, fp);
+    if(fclose(fp) != 0 && ret == SARG_ERR_SUCCESS)
+        ret = SARG_ERR_ERRNO;
 
-    return SARG_ERR_SUCCESS;
+    return ret;
 }
 
-static const char *_sarg_opt_type_str[COUNT] = {
-    "INT",
-    "UINT",
-    "DOUBLE",
-    "",
-    "STRING"
-};
+#endif
+
+#ifndef SARG_NO_MALLOC
 
 /**
- * @brief Prints a help text into the given buffer.
- *
- * The root object has to be initialized with sarg_init before
- * being passed to this function.
+ * @brief Prints the help text of a subcommand into the given buffer.
  *
- * This function dynamically allocates memory for the given
- * buffer, so that the help text fits into the buffer. outbuf
- * has to be freed manually afterwards.
+ * Only the options of the given subcommand are listed. Commands which
+ * are not currently selected are initialized temporarily. outbuf is
+ * allocated with the allocator of root and has to be released with
+ * sarg_free_text on root.
  *
- * @param root root object for creating help text
+ * @param root root object with registered subcommands
+ * @param cmd name of the subcommand
  * @param outbuf dynamically allocated output buffer for help text
  *
  * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
  */
-int sarg_help_text(sarg_root *root, char **outbuf)
+int sarg_command_help_text(sarg_root *root, const char *cmd, char **outbuf)
 {
-    int outlen, linelen,  i, offset, lineoff, ret;
-    char *linebuf = NULL;
-    const char *type_name;
+    sarg_root cmd_root;
+    int cmd_idx, ret;
+
     *outbuf = NULL;
 
-    // alloc output buffer and tmp buffer
-    outlen = 256;
-    *outbuf = (char *) malloc(outlen);
-    if(!*outbuf)
-        return SARG_ERR_ALLOC;
+    cmd_idx = _sarg_find_cmd(root, cmd);
+    if(cmd_idx < 0)
+        return SARG_ERR_NOTFOUND;
 
-    linelen = 128;
-    linebuf = (char *) malloc(linelen);
-    if(!linebuf) {
-        ret = SARG_ERR_ALLOC;
-        goto _sarg_help_text_exit;
-    }
+    if(root->cmd_root && root->cmd_idx == cmd_idx)
+        return _sarg_help_text(root->cmd_root, root, outbuf);
 
-    offset = 0;
-    ret = _sarg_snprintf(outbuf, &outlen, &offset,
-                         "Usage: %s [OPTION]... [ARG]...\n\n", root->name);
+    ret = _sarg_cmd_init(root, cmd_idx, &cmd_root);
     if(ret != SARG_ERR_SUCCESS)
-        goto _sarg_help_text_exit;
-
-    for(i = 0; i < root->opt_len; ++i) {
-        lineoff = 0;
-        linebuf[0] = '\0';
-        type_name = _sarg_opt_type_str[root->opts[i].type];
-        // create output depending on which options are available
-        if(root->opts[i].short_name && root->opts[i].long_name) {
-            ret = _sarg_snprintf(&linebuf, &linelen, &lineoff, "  -%s, --%s %s",
-                                 root->opts[i].short_name, root->opts[i].long_name, type_name);
-            if(ret != SARG_ERR_SUCCESS)
-                goto _sarg_help_text_exit;
-        } else if(root->opts[i].short_name) {
-            ret = _sarg_snprintf(&linebuf, &linelen, &lineoff, "  -%s %s",
-                                 root->opts[i].short_name, type_name);
-            if(ret != SARG_ERR_SUCCESS)
-                goto _sarg_help_text_exit;
-        } else if(root->opts[i].long_name) {
-            ret = _sarg_snprintf(&linebuf, &linelen, &lineoff, "  --%s %s",
-                                 root->opts[i].long_name, type_name);
-            if(ret != SARG_ERR_SUCCESS)
-                goto _sarg_help_text_exit;
-        }
-
-        // print options string into outbuf
-        ret = _sarg_snprintf(outbuf, &outlen, &offset, "%-30s", linebuf);
-        if(ret != SARG_ERR_SUCCESS)
-            goto _sarg_help_text_exit;
-
-        if(root->opts[i].help) {
-            ret = _sarg_snprintf(outbuf, &outlen, &offset, "%s", root->opts[i].help);
-            if(ret != SARG_ERR_SUCCESS)
-                goto _sarg_help_text_exit;
-        }
-
-        ret = _sarg_snprintf(outbuf, &outlen, &offset, "\n");
-        if(ret != SARG_ERR_SUCCESS)
-            goto _sarg_help_text_exit;
-    }
+        return ret;
 
-    free(linebuf);
-    return SARG_ERR_SUCCESS;
+    ret = _sarg_help_text(&cmd_root, root, outbuf);
+    sarg_destroy(&cmd_root);
 
-_sarg_help_text_exit:
-    if(outbuf) {
-        free(*outbuf);
-        *outbuf = NULL;
-    }
-    if(linebuf)
-        free(linebuf);
     return ret;
 }
 
 /**
- * @brief Prints a help text to stdout.
+ * @brief Prints the help text of a subcommand to stdout.
  *
- * @param root root object for creating help text
+ * @param root root object with registered subcommands
+ * @param cmd name of the subcommand
  *
  * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
  */
-int sarg_help_print(sarg_root *root)
+int sarg_command_help_print(sarg_root *root, const char *cmd)
 {
     char *buf;
     int ret;
 
-    ret = sarg_help_text(root, &buf);
+    ret = sarg_command_help_text(root, cmd, &buf);
     if(ret != SARG_ERR_SUCCESS)
         return ret;
     printf("%s", buf);
-    free(buf);
+    sarg_free_text(root, buf);
 
     return SARG_ERR_SUCCESS;
 }
 
 #endif
 
+#endif
+
 #ifndef SARG_NO_FILE
 
 #include <stdio.h>
 #include <ctype.h>
 
-char *_sarg_trim(char *str)
+/**
+ * Parses the lines of an argument file held in buf. The first word of
+ * a line names an option, the rest of the line without surrounding
+ * whitespace is its value. Names and values point into the buffer,
+ * nothing is copied. On failure err_idx is the offset of the offending
+ * word.
+ */
+_SARG_INTERNAL int _sarg_parse_arg_lines(sarg_root *root, const char *buf, const size_t len)
 {
-    char *end;
-
-    // Trim leading space
-    while(isspace((unsigned char)*str)) str++;
+    const char *line, *eol, *end, *stop, *val, *err;
+    _sarg_parse_ctx ctx;
+    _sarg_token tok;
+    int ret;
 
-    if(*str == 0)
-        return str;
+    ctx.pending = -1;
+    ctx.rest = 0;
+    ctx.depth = 0;
+    line = buf;
+    end = buf + len;
 
-    // Trim trailing space
-    end = str + strlen(str) - 1;
-    while(end > str && isspace((unsigned char)*end)) end--;
+    for(; line < end; line = eol + 1) {
+        eol = (const char *) memchr(line, '\n', end - line);
+        if(!eol)
+            eol = end;
 
-    // Write new null terminator
-    *(end + 1) = '\0';
+        for(stop = eol; stop > line && _SARG_IS_SPACE(stop[-1]); --stop);
+        for(; line < stop && _SARG_IS_SPACE(*line); ++line);
+        if(line == stop)
+            continue;
+        for(val = line; val < stop && !_SARG_IS_SPACE(*val); ++val);
+
+        // the name is read as if it was preceded by a dash
+        tok.kind = _SARG_TOK_SHORT;
+        tok.name = line;
+        tok.name_len = val - line;
+        tok.len = tok.name_len + 1;
+        tok.value = NULL;
+        tok.value_len = 0;
+        ret = _sarg_parse_token(root, &ctx, line, &tok);
+        err = line;
+
+        if(ret == SARG_ERR_SUCCESS && val < stop) {
+            for(; _SARG_IS_SPACE(*val); ++val);
+            err = val;
+            // options without a value must not drop further words
+            if(ctx.pending < 0)
+                ret = SARG_ERR_PARSE;
+            else
+                ret = _sarg_parse_arg(root, &ctx, val, stop - val);
+        }
+        // every option takes its value from the same line
+        if(ret == SARG_ERR_SUCCESS && ctx.pending >= 0) {
+            err = line;
+            ret = SARG_ERR_PARSE;
+        }
+        if(ret != SARG_ERR_SUCCESS) {
+            root->err_idx = (int) (err - buf);
+            return ret;
+        }
+    }
 
-    return str;
+    return SARG_ERR_SUCCESS;
 }
 
-int _sarg_argv_resize(char ***argv, int *argc)
+/**
+ * @brief Parse arguments from the given argument file.
+ *
+ * Options in the file are specified without preceding dashes
+ * '-'. If the option expects an additional parameter it has to
+ * be separated by a whitespace ' '. One line per option.
+ *
+ * The arguments in the file have to be specified in the
+ * following format:
+ *
+ * OPTION1 ARG
+ * OPTION2 ARG
+ * OPTION3
+ * ...
+ *
+ * A line holds exactly one option. Options without a value, like
+ * BOOL, must stand alone, and the value of any other option is the
+ * rest of the line.
+ *
+ * The file is mapped into memory, or read at once where mmap is not
+ * available, and parsed in place. On failure the byte offset of the
+ * offending word in the file, i.e. the option name, its value or a
+ * word following an option without a value, is stored in
+ * root->err_idx, otherwise it is set to -1.
+ *
+ * The rules of sarg_add_rule are not checked, since options given
+ * later on the command line may satisfy them. Call sarg_check once all
+ * sources are parsed.
+ *
+ * @param root root object which should be used to parse arguments
+ * @param filename file which should be used to read arguments
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_file(sarg_root *root, const char *filename)
 {
-    int argc_tmp = *argc;
-    char **argv_tmp = *argv;
-    int i;
+    _sarg_file_map map;
+    int ret;
 
-    *argv = (char **) malloc(sizeof(char *) * argc_tmp * 2);
-    if(!(*argv)) {
-        *argv = argv_tmp;
-        return SARG_ERR_ALLOC;
-    }
-    *argc = argc_tmp * 2;
+    root->err_idx = -1;
+    ret = _sarg_file_map_open(root, filename, &map);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
 
-    memset(argv, 0, sizeof(char *) * argc_tmp);
-    for(i = 0; i < argc_tmp; ++i)
-        (*argv)[i] = argv_tmp[i];
-    free(argv_tmp);
+    ret = _sarg_parse_arg_lines(root, map.data, map.len);
+    _sarg_file_map_close(root, &map);
 
-    return SARG_ERR_SUCCESS;
+    return ret;
 }
 
-int _sarg_argv_add_arg(const char *fmt, const char *arg, int arglen,
-                       char **argv, int *currarg)
+/**
+ * @brief Parses options from a file in INI format.
+ *
+ * The file is mapped into memory and parsed with sarg_parse_ini.
+ *
+ * @param root root object which should be used to parse options
+ * @param filename path to the INI file
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_ini_file(sarg_root *root, const char *filename)
 {
+    _sarg_file_map map;
     int ret;
 
-    argv[*currarg] = (char *) malloc(arglen);
-    if(!argv[*currarg])
-        return SARG_ERR_ALLOC;
+    root->err_idx = -1;
+    ret = _sarg_file_map_open(root, filename, &map);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
 
-    ret = snprintf(argv[*currarg], arglen, fmt, arg);
-    argv[*currarg][arglen - 1] = '\0';
-    ++(*currarg);
-    if(ret < 0)
-        return SARG_ERR_OTHER;
+    ret = sarg_parse_ini(root, map.data, map.len);
+    _sarg_file_map_close(root, &map);
 
-    return SARG_ERR_SUCCESS;
+    return ret;
 }
 
-int _sarg_argv_add_from_line(const char *line, char ***argv, int *argc,
-                             int *currarg)
+/**
+ * @brief Parses options from a file holding a JSON object.
+ *
+ * The file is mapped into memory and parsed with sarg_parse_json.
+ *
+ * @param root root object which should be used to parse options
+ * @param filename path to the JSON file
+ *
+ * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ */
+int sarg_parse_json_file(sarg_root *root, const char *filename)
 {
-    int diff, ret, arglen;
-    char *sep;
-
-    diff = *argc - *currarg;
-    if(diff < 2) {
-        ret = _sarg_argv_resize(argv, argc);
-        if(ret != SARG_ERR_SUCCESS)
-            return ret;
-    }
-
-    // find separating space
-    sep = strchr((char*) line, ' ');
-    arglen = strlen(line) + 2;
-    if(sep)
-        arglen -= strlen(sep);
+    _sarg_file_map map;
+    int ret;
 
-    // write first arg into argv
-    ret = _sarg_argv_add_arg("-%s", line, arglen, *argv, currarg);
+    root->err_idx = -1;
+    ret = _sarg_file_map_open(root, filename, &map);
     if(ret != SARG_ERR_SUCCESS)
         return ret;
 
-    // write second argument if found into array
-    if(sep) {
-        sep = _sarg_trim(sep);
-        arglen = strlen(sep) + 1;
+    ret = sarg_parse_json(root, map.data, map.len);
+    _sarg_file_map_close(root, &map);
 
-        _sarg_argv_add_arg("%s", sep, arglen, *argv, currarg);
-        if(ret != SARG_ERR_SUCCESS)
-            return ret;
+    return ret;
+}
+
+#if !defined(SARG_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define _SARG_HAVE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifndef SARG_MAX_THREADS
+#define SARG_MAX_THREADS 64
+#endif
+
+typedef struct _sarg_file_queue {
+    sarg_file_job *jobs;
+    int len;
+    // next job that has not been taken by a worker
+    int next;
+#ifdef _SARG_HAVE_THREADS
+    pthread_mutex_t lock;
+    int locked;
+#endif
+} _sarg_file_queue;
+
+/**
+ * Parses the jobs of the queue until all of them have been taken.
+ */
+_SARG_INTERNAL void *_sarg_file_worker(void *arg)
+{
+    _sarg_file_queue *queue = (_sarg_file_queue *) arg;
+    sarg_file_job *job;
+    int idx;
+
+    for(;;) {
+#ifdef _SARG_HAVE_THREADS
+        if(queue->locked)
+            pthread_mutex_lock(&queue->lock);
+#endif
+        idx = queue->next < queue->len ? queue->next++ : -1;
+#ifdef _SARG_HAVE_THREADS
+        if(queue->locked)
+            pthread_mutex_unlock(&queue->lock);
+#endif
+        if(idx < 0)
+            break;
+
+        job = &queue->jobs[idx];
+        job->ret = sarg_parse_file(job->root, job->filename);
     }
 
-    return SARG_ERR_SUCCESS;
+    return NULL;
 }
 
 /**
- * @brief Parse arguments from the given argument file.
- *
- * Options in the file are specified without preceding dashes
- * '-'. If the option expects an additional parameter it has to
- * be separated by a whitespace ' '. One line per option.
- *
- * The arguments in the file have to be specified in the
- * following format:
+ * @brief Parses many argument files concurrently.
  *
- * OPTION1 ARG
- * OPTION2 ARG
- * OPTION3
- * ...
+ * Each job is parsed with sarg_parse_file into its own root and its
+ * result is stored in the ret field of the job. The files are spread
+ * over a pool of threads, so waiting for one file does not delay the
+ * others. Every root may only appear in one job and roots that share
+ * a custom allocator need a thread safe one. Without POSIX threads or
+ * with SARG_NO_THREADS defined the files are parsed one after another.
  *
- * @param root root object which should be used to parse arguments
- * @param filename file which should be used to read arguments
+ * @param jobs roots and the files to parse into them
+ * @param len number of jobs
+ * @param threads maximum number of threads including the calling one,
+ *                0 uses one per online processor
  *
- * @return SARG_ERR_SUCCESS on success or a SARG_ERR_* code otherwise
+ * @return SARG_ERR_SUCCESS if all files were parsed or the error of
+ *         the first job that failed
  */
-int sarg_parse_file(sarg_root *root, const char *filename)
+int sarg_parse_files(sarg_file_job *jobs, const int len, const int threads)
 {
-    int argc, currarg, ret, i;
-    size_t len;
-    FILE *fp = NULL;
-    char **argv = NULL;
-    char *line = NULL;
-    char *line_trim = NULL;
-
-    fp = fopen(filename , "r");
-    if(!fp)
-        return SARG_ERR_ERRNO;
+    _sarg_file_queue queue;
+    int i, count;
+#ifdef _SARG_HAVE_THREADS
+    pthread_t workers[SARG_MAX_THREADS];
+    int started = 0;
+#endif
 
-    currarg = 1;
-    argc = 16;
-    argv = (char **) malloc(sizeof(char *) * argc);
-    if(!argv) {
-        ret = SARG_ERR_ALLOC;
-        goto _sarg_parse_file_exit;
-    }
-    memset(argv, 0, sizeof(char *) * argc);
+    if(len < 0 || (len > 0 && !jobs) || threads < 0)
+        return SARG_ERR_INVALARG;
 
-    // convert arguments in file to arg vector
-    len = 0;
-    while((ret = getline(&line, &len, fp)) != -1) {
-        line_trim = _sarg_trim(line);
-        if(strlen(line_trim) == 0)
-            continue;
+    queue.jobs = jobs;
+    queue.len = len;
+    queue.next = 0;
 
-        ret = _sarg_argv_add_from_line(line_trim, &argv, &argc, &currarg);
-        if(ret != SARG_ERR_SUCCESS)
-            goto _sarg_parse_file_exit;
+    count = threads;
+#ifdef _SARG_HAVE_THREADS
+    if(count == 0)
+        count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if(count > len)
+        count = len;
+    if(count > SARG_MAX_THREADS)
+        count = SARG_MAX_THREADS;
+
+#ifdef _SARG_HAVE_THREADS
+    queue.locked = count > 1 && pthread_mutex_init(&queue.lock, NULL) == 0;
+    if(queue.locked) {
+        // the calling thread is a worker as well
+        for(started = 0; started < count - 1; ++started) {
+            if(pthread_create(&workers[started], NULL, _sarg_file_worker,
+                              &queue) != 0)
+                break;
+        }
     }
+#endif
 
-    // parse created arg vector
-    ret = sarg_parse(root, (const char **) argv, currarg);
-    if(ret != SARG_ERR_SUCCESS)
-        goto _sarg_parse_file_exit;
+    _sarg_file_worker(&queue);
 
-    ret = SARG_ERR_SUCCESS;
+#ifdef _SARG_HAVE_THREADS
+    for(i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+    if(queue.locked)
+        pthread_mutex_destroy(&queue.lock);
+#else
+    _SARG_UNUSED(count);
+#endif
 
-_sarg_parse_file_exit:
-    if(line)
-        free(line);
-    if(argv) {
-        for(i = 0; i < currarg; ++i) {
-            if(argv[i])
-                free(argv[i]);
-        }
-        free(argv);
+    for(i = 0; i < len; ++i) {
+        if(jobs[i].ret != SARG_ERR_SUCCESS)
+            return jobs[i].ret;
     }
-    if(fp)
-        fclose(fp);
-    return ret;
+
+    return SARG_ERR_SUCCESS;
 }
 
 #endif
 
-#endif
+#endif /* SARG_IMPLEMENTATION */
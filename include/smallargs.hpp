@@ -33,12 +33,29 @@
 #ifndef INCLUDE_SMALLARGS_HPP_
 #define INCLUDE_SMALLARGS_HPP_
 
-#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
 #include <string>
 #include <stdexcept>
-#include <sstream>
+#include <utility>
 #include <vector>
 
+#if defined(__has_include)
+#if __has_include(<string_view>) && __cplusplus >= 201703L
+#include <string_view>
+#endif
+#if __has_include(<span>) && __cplusplus >= 202002L
+#include <span>
+#endif
+#endif
+
+#ifdef SARG_NO_MALLOC
+#error "smallargs.hpp does not support SARG_NO_MALLOC"
+#endif
+
 extern "C" {
 #include "smallargs.h"
 }
@@ -50,19 +67,236 @@ namespace sarg
     typedef sarg_result result;
     typedef sarg_opt_cb optCallback;
 
-    class Error : public std::exception
+#ifdef __cpp_lib_string_view
+    typedef std::string_view StringView;
+#else
+    /**
+     * Characters owned by someone else, the subset of std::string_view
+     * the wrapper needs before C++17.
+     */
+    class StringView
+    {
+    private:
+        const char *data_;
+        size_t size_;
+
+    public:
+        StringView()
+        :data_(""), size_(0)
+        {}
+
+        StringView(const char *str)
+        :data_(str), size_(std::strlen(str))
+        {}
+
+        StringView(const char *str, const size_t len)
+        :data_(str), size_(len)
+        {}
+
+        StringView(const std::string &str)
+        :data_(str.data()), size_(str.size())
+        {}
+
+        const char *data() const
+        {
+            return data_;
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        const char *begin() const
+        {
+            return data_;
+        }
+
+        const char *end() const
+        {
+            return data_ + size_;
+        }
+
+        char operator[](const size_t pos) const
+        {
+            return data_[pos];
+        }
+
+        bool operator==(const StringView &other) const
+        {
+            return size_ == other.size_
+                && std::memcmp(data_, other.data_, size_) == 0;
+        }
+
+        bool operator!=(const StringView &other) const
+        {
+            return !(*this == other);
+        }
+    };
+#endif
+
+#ifdef __cpp_lib_span
+    typedef std::span<const char *> ArgSpan;
+#else
+    /**
+     * Argument vector owned by someone else, the subset of
+     * std::span<const char *> the wrapper needs before C++20.
+     */
+    class ArgSpan
+    {
+    private:
+        const char **data_;
+        size_t size_;
+
+    public:
+        ArgSpan()
+        :data_(NULL), size_(0)
+        {}
+
+        ArgSpan(const char **argv, const size_t argc)
+        :data_(argv), size_(argc)
+        {}
+
+        ArgSpan(std::vector<const char *> &args)
+        :data_(args.data()), size_(args.size())
+        {}
+
+        template<size_t N>
+        ArgSpan(const char *(&args)[N])
+        :data_(args), size_(N)
+        {}
+
+        const char **data() const
+        {
+            return data_;
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        const char **begin() const
+        {
+            return data_;
+        }
+
+        const char **end() const
+        {
+            return data_ + size_;
+        }
+
+        const char *operator[](const size_t pos) const
+        {
+            return data_[pos];
+        }
+    };
+#endif
+
+    /**
+     * Outcome of a non-throwing operation. Carries the SARG_ERR_* code
+     * and, for parse errors, the index and value of the offending
+     * argument. Creating and copying a status never allocates.
+     */
+    class Status
     {
     private:
         int errVal_;
-        std::string errMsg_;
+        int index_;
+        const char *token_;
+        size_t tokenLength_;
+
+    public:
+        Status()
+        :errVal_(SARG_ERR_SUCCESS), index_(-1), token_(NULL), tokenLength_(0)
+        {}
+
+        Status(const int errVal, const int index = -1,
+            const char *token = NULL)
+        :errVal_(errVal), index_(index), token_(token),
+        tokenLength_(token ? std::strlen(token) : 0)
+        {}
+
+        Status(const int errVal, const int index, StringView token)
+        :errVal_(errVal), index_(index), token_(token.data()),
+        tokenLength_(token.size())
+        {}
+
+        bool ok() const
+        {
+            return errVal_ == SARG_ERR_SUCCESS;
+        }
+
+        explicit operator bool() const
+        {
+            return ok();
+        }
+
+        int errval() const
+        {
+            return errVal_;
+        }
+
+        /** Index of the offending argument in argv or -1. */
+        int index() const
+        {
+            return index_;
+        }
+
+        /**
+         * Offending argument or NULL. Points into the parsed argv or,
+         * if a rule was violated, to the name of the option. After
+         * parsing a command line it points into the command line and is
+         * not terminated, so only tokenLength() characters belong to it.
+         */
+        const char *token() const
+        {
+            return token_;
+        }
+
+        size_t tokenLength() const
+        {
+            return tokenLength_;
+        }
+
+        /** Offending argument as a view, empty if there is none. */
+        StringView tokenView() const
+        {
+            if(!token_)
+                return StringView();
+            return StringView(token_, tokenLength_);
+        }
+
+        const char *message() const
+        {
+            return sarg_strerror(errVal_);
+        }
+    };
+
+    class Error : public std::exception
+    {
+    private:
+        Status status_;
 
     public:
         Error(const int errVal) throw()
-        : errVal_(errVal), errMsg_()
+        : status_(errVal)
+        {
+        }
+
+        Error(const Status &status) throw()
+        : status_(status)
         {
-            std::stringstream ss;
-            ss << errVal_ << ": " << sarg_strerror(errVal);
-            errMsg_ = ss.str();
         }
 
         ~Error() throw()
@@ -72,44 +306,403 @@ namespace sarg
 
         const char* what() const throw()
         {
-            return errMsg_.c_str();
+            return status_.message();
         }
 
-        int errval()
+        int errval() const
         {
-            return errVal_;
+            return status_.errval();
+        }
+
+        const Status &status() const
+        {
+            return status_;
+        }
+    };
+
+    /**
+     * Either a value or the status describing why there is none.
+     */
+    template<typename T>
+    class Expected
+    {
+    private:
+        Status status_;
+        const T *value_;
+
+    public:
+        Expected(const T &value)
+        :status_(), value_(&value)
+        {}
+
+        Expected(const Status &status)
+        :status_(status), value_(NULL)
+        {}
+
+        bool ok() const
+        {
+            return status_.ok();
+        }
+
+        explicit operator bool() const
+        {
+            return ok();
+        }
+
+        const Status &status() const
+        {
+            return status_;
+        }
+
+        const T &value() const
+        {
+            if(!ok())
+                throw Error(status_);
+            return *value_;
+        }
+
+        const T &operator*() const
+        {
+            return *value_;
+        }
+
+        const T *operator->() const
+        {
+            return value_;
         }
     };
 
     class Root
     {
     private:
-        std::string name_;
+        /* Option definitions of a root. Once the root is initialized the
+         * schema is immutable and can be shared by clones. Its prototype
+         * root holds the name index, defaults, rules, choices and ranges,
+         * which every root of the schema borrows with sarg_init_copy. */
+        struct Schema
+        {
+            /* Option as added to the schema. Strings are stored as
+             * offsets into text, because text may still grow. */
+            struct Entry
+            {
+                long shortName;
+                long longName;
+                long help;
+                optType type;
+                optCallback cb;
+            };
+
+            struct Rule
+            {
+                int type;
+                std::vector<std::string> names;
+            };
+
+            /* Allowed values of an ENUM option. The NULL-terminated
+             * array of values is only built with the schema, because
+             * moving the strings may move their characters. */
+            struct Choices
+            {
+                std::string name;
+                std::vector<std::string> values;
+                std::vector<const char *> array;
+            };
+
+            struct Range
+            {
+                std::string name;
+                double min;
+                double max;
+            };
+
+            std::string name;
+            std::vector<char> text;
+            std::vector<Entry> entries;
+            std::vector<opt> opts;
+            std::vector<std::pair<std::string, std::string> > defaults;
+            std::vector<Rule> rules;
+            std::vector<Choices> choices;
+            std::vector<Range> ranges;
+            sarg_root proto;
+            // opts and the arrays of choices were built
+            bool built;
+            // proto was initialized and holds the defaults and rules
+            bool ready;
+
+            Schema(StringView name)
+            :name(name.data(), name.size()), text(), entries(), opts(), defaults(), rules(),
+            choices(), ranges(), built(false), ready(false)
+            {
+                std::memset(&proto, 0, sizeof(proto));
+            }
+
+            Schema(const Schema &schema) = delete;
+            Schema &operator=(const Schema &schema) = delete;
+
+            ~Schema()
+            {
+                if(ready)
+                    sarg_destroy(&proto);
+            }
+
+            long store(const char *str)
+            {
+                long offset;
+
+                if(!str)
+                    return -1;
+
+                offset = text.size();
+                text.insert(text.end(), str, str + std::strlen(str) + 1);
+
+                return offset;
+            }
+
+            char *lookup(const long offset)
+            {
+                return offset < 0 ? NULL : &text[offset];
+            }
+
+            /* Builds the final option array, which points into text. Only
+             * runs until it succeeds once, because it releases the entries. */
+            void build()
+            {
+                unsigned int i;
+
+                opts.resize(entries.size());
+                for(i = 0; i < entries.size(); ++i) {
+                    opts[i].short_name = lookup(entries[i].shortName);
+                    opts[i].long_name = lookup(entries[i].longName);
+                    opts[i].help = lookup(entries[i].help);
+                    opts[i].type = entries[i].type;
+                    opts[i].callback = entries[i].cb;
+                }
+
+                for(i = 0; i < choices.size(); ++i) {
+                    std::vector<std::string> &values = choices[i].values;
+                    // a previous attempt may have run out of memory
+                    choices[i].array.clear();
+                    for(unsigned int j = 0; j < values.size(); ++j)
+                        choices[i].array.push_back(values[j].c_str());
+                    choices[i].array.push_back(NULL);
+                }
+
+                std::vector<Entry>().swap(entries);
+            }
+
+            /* Applies the defaults and rules to the prototype. */
+            int apply()
+            {
+                std::vector<const char *> names;
+                unsigned int i, j;
+                int ret;
+
+                // defaults depend on choices and ranges
+                for(i = 0; i < choices.size(); ++i) {
+                    ret = sarg_set_choices(&proto, choices[i].name.c_str(),
+                        choices[i].array.data());
+                    if(ret != SARG_ERR_SUCCESS)
+                        return ret;
+                }
+
+                for(i = 0; i < ranges.size(); ++i) {
+                    ret = sarg_set_range(&proto, ranges[i].name.c_str(),
+                        ranges[i].min, ranges[i].max);
+                    if(ret != SARG_ERR_SUCCESS)
+                        return ret;
+                }
+
+                for(i = 0; i < defaults.size(); ++i) {
+                    ret = sarg_set_default(&proto, defaults[i].first.c_str(),
+                        defaults[i].second.c_str());
+                    if(ret != SARG_ERR_SUCCESS)
+                        return ret;
+                }
+
+                for(i = 0; i < rules.size(); ++i) {
+                    names.clear();
+                    for(j = 0; j < rules[i].names.size(); ++j)
+                        names.push_back(rules[i].names[j].c_str());
+                    names.push_back(NULL);
+
+                    ret = sarg_add_rule(&proto, rules[i].type, names.data());
+                    if(ret != SARG_ERR_SUCCESS)
+                        return ret;
+                }
+
+                return SARG_ERR_SUCCESS;
+            }
+
+            /* Builds the option array and the prototype once. If the
+             * prototype fails, e.g. on an invalid default, it is set up
+             * again from the same option array on the next call. */
+            int prepare()
+            {
+                int ret;
+
+                if(ready)
+                    return SARG_ERR_SUCCESS;
+
+                if(!built) {
+                    try {
+                        build();
+                    } catch(std::bad_alloc &e) {
+                        return SARG_ERR_ALLOC;
+                    }
+                    built = true;
+                }
+
+                ret = sarg_init_shared(&proto, opts.data(), opts.size(),
+                    name.c_str());
+                if(ret != SARG_ERR_SUCCESS)
+                    return ret;
+
+                ret = apply();
+                if(ret != SARG_ERR_SUCCESS) {
+                    sarg_destroy(&proto);
+                    return ret;
+                }
+                ready = true;
+
+                return SARG_ERR_SUCCESS;
+            }
+        };
+
+        std::shared_ptr<Schema> schema_;
         sarg_root root_;
-        std::vector<opt> opts_;
         bool init_;
+        // help text built by sarg_help_text, kept for helpText()
+        char *help_;
+
+        Root(const std::shared_ptr<Schema> &schema)
+        :schema_(schema), init_(false), help_(NULL)
+        {
+            std::memset(&root_, 0, sizeof(root_));
+        }
+
+        void release()
+        {
+            // the help text comes from the allocator of the root
+            sarg_free_text(&root_, help_);
+            help_ = NULL;
+            sarg_destroy(&root_);
+            std::memset(&root_, 0, sizeof(root_));
+            init_ = false;
+        }
+
+        /* Status of a failed parse that did not come from an argument. */
+        Status ruleStatus(const int ret)
+        {
+            const opt *o;
+
+            if(root_.err_opt < 0)
+                return Status(ret);
+
+            o = &root_.opts[root_.err_opt];
+            return Status(ret, -1, o->long_name ? o->long_name : o->short_name);
+        }
+
+        /*
+         * Length of the argument at pos of a command line as written,
+         * including its quotes and escapes, see sarg_parse_string.
+         */
+        static size_t argLength(StringView cmdline, const size_t pos)
+        {
+            size_t end;
+            char quote = '\0';
+
+            for(end = pos; end < cmdline.size(); ++end) {
+                const char c = cmdline[end];
+
+                if(quote == '\0' && c != '\0' && std::strchr(" \t\n\r\v\f", c))
+                    break;
+                if(c == '\\' && quote != '\'')
+                    ++end;
+                else if(quote == '\0' && (c == '"' || c == '\''))
+                    quote = c;
+                else if(c == quote)
+                    quote = '\0';
+            }
+
+            return (end < cmdline.size() ? end : cmdline.size()) - pos;
+        }
 
     public:
-        Root(const std::string& name)
-        :name_(name), init_(false)
-        {}
+        Root(StringView name)
+        :schema_(std::make_shared<Schema>(name)), init_(false), help_(NULL)
+        {
+            std::memset(&root_, 0, sizeof(root_));
+        }
+
+        Root(const Root& root) = delete;
+        Root &operator=(const Root& root) = delete;
 
-        Root(const Root& root)
-        :name_(root.name_), init_(false)
+        /**
+         * Takes over the schema and the parsing results of the given
+         * root. The moved-from root may only be destroyed or assigned to.
+         */
+        Root(Root&& root) noexcept
+        :schema_(std::move(root.schema_)), root_(root.root_), init_(root.init_),
+        help_(root.help_)
         {
-            //TODO
-            _SARG_UNUSED(root);
-            assert(false);
+            std::memset(&root.root_, 0, sizeof(root.root_));
+            root.init_ = false;
+            root.help_ = NULL;
         }
 
-        ~Root()
+        Root &operator=(Root&& root) noexcept
         {
-            unsigned int i;
+            if(this != &root) {
+                release();
+                schema_ = std::move(root.schema_);
+                root_ = root.root_;
+                init_ = root.init_;
+                help_ = root.help_;
+                std::memset(&root.root_, 0, sizeof(root.root_));
+                root.init_ = false;
+                root.help_ = NULL;
+            }
+
+            return *this;
+        }
 
+        ~Root()
+        {
+            sarg_free_text(&root_, help_);
             sarg_destroy(&root_);
+        }
 
-            for(i = 0; i < opts_.size(); ++i)
-                _sarg_opt_destroy(&opts_[i]);
+        /**
+         * Creates an initialized root which shares the schema of this
+         * root. Neither the schema nor its name index, defaults, rules
+         * and choices are copied or rebuilt, only the results are
+         * allocated. The clone starts without any parsing results.
+         */
+        Root clone() const
+        {
+            if(!init_)
+                throw std::logic_error("root was not initialized");
+
+            Root result(schema_);
+            result.init();
+
+            return result;
+        }
+
+        /**
+         * Reserves memory for the given number of options and total
+         * length of their names and help texts, so that adding them
+         * does not reallocate.
+         */
+        Root &reserve(const size_t optCount, const size_t textLen = 0)
+        {
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            schema_->entries.reserve(optCount);
+            schema_->text.reserve(textLen);
+
+            return *this;
         }
 
         Root &add(const char *shortName,
@@ -121,16 +714,103 @@ namespace sarg
             if(init_)
                 throw std::logic_error("root was already initialized");
 
-            int ret;
-            opts_.resize(opts_.size() + 1);
-            ret = _sarg_opt_init(&opts_.back(),
-                    shortName,
-                    longName,
-                    help,
-                    type,
-                    cb);
-            if(ret != SARG_ERR_SUCCESS)
-                throw Error(ret);
+            Schema::Entry entry;
+            try {
+                entry.shortName = schema_->store(shortName);
+                entry.longName = schema_->store(longName);
+                entry.help = schema_->store(help);
+                entry.type = type;
+                entry.cb = cb;
+                schema_->entries.push_back(entry);
+            } catch(std::bad_alloc &e) {
+                throw Error(SARG_ERR_ALLOC);
+            }
+
+            return *this;
+        }
+
+        /**
+         * Sets the default value of an option, see sarg_set_default.
+         * Clones share the defaults.
+         */
+        Root &setDefault(StringView name, StringView value)
+        {
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            try {
+                schema_->defaults.push_back(std::make_pair(
+                    std::string(name.data(), name.size()),
+                    std::string(value.data(), value.size())));
+            } catch(std::bad_alloc &e) {
+                throw Error(SARG_ERR_ALLOC);
+            }
+
+            return *this;
+        }
+
+        /**
+         * Adds a SARG_RULE_* rule on the given options, see
+         * sarg_add_rule. Clones share the rules.
+         */
+        Root &addRule(const int type, std::initializer_list<const char *> names)
+        {
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            try {
+                Schema::Rule rule;
+                rule.type = type;
+                rule.names.assign(names.begin(), names.end());
+                schema_->rules.push_back(rule);
+            } catch(std::bad_alloc &e) {
+                throw Error(SARG_ERR_ALLOC);
+            }
+
+            return *this;
+        }
+
+        /**
+         * Sets the allowed values of an ENUM option, see
+         * sarg_set_choices. Clones share the choices.
+         */
+        Root &setChoices(StringView name,
+            std::initializer_list<const char *> values)
+        {
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            try {
+                Schema::Choices choices;
+                choices.name.assign(name.data(), name.size());
+                choices.values.assign(values.begin(), values.end());
+                schema_->choices.push_back(choices);
+            } catch(std::bad_alloc &e) {
+                throw Error(SARG_ERR_ALLOC);
+            }
+
+            return *this;
+        }
+
+        /**
+         * Restricts the values of a number option, see sarg_set_range.
+         * Clones share the range.
+         */
+        Root &setRange(StringView name, const double min,
+            const double max)
+        {
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            try {
+                Schema::Range range;
+                range.name.assign(name.data(), name.size());
+                range.min = min;
+                range.max = max;
+                schema_->ranges.push_back(range);
+            } catch(std::bad_alloc &e) {
+                throw Error(SARG_ERR_ALLOC);
+            }
 
             return *this;
         }
@@ -138,52 +818,181 @@ namespace sarg
         void init()
         {
             int ret;
-            opt nullOpt = {NULL, NULL, NULL, INT, NULL};
-            opts_.push_back(nullOpt);
 
-            ret = sarg_init(&root_, &opts_[0], name_.c_str());
+            if(init_)
+                throw std::logic_error("root was already initialized");
+
+            // only the first root of a schema builds its tables, all
+            // roots including the first one borrow them from the prototype
+            ret = schema_->prepare();
+            if(ret != SARG_ERR_SUCCESS)
+                throw Error(ret);
+
+            ret = sarg_init_copy(&root_, &schema_->proto);
             if(ret != SARG_ERR_SUCCESS)
                 throw Error(ret);
 
             init_ = true;
         }
 
-        const result& operator[](const std::string &key)
+        /**
+         * Looks up the result of the given option without throwing.
+         */
+        Expected<result> tryGet(StringView key)
         {
             int ret;
             result *res;
 
-            ret = sarg_get(&root_, key.c_str(), &res);
+            ret = sarg_get_n(&root_, key.data(), key.size(), &res);
             if(ret != SARG_ERR_SUCCESS)
-                throw Error(ret);
+                return Status(ret);
 
             return *res;
         }
 
-        void parse(const char **argv, const int argc)
+        const result& operator[](StringView key)
+        {
+            return tryGet(key).value();
+        }
+
+        /**
+         * Value of a STRING option without copying it. The view stays
+         * valid until the option is parsed again or the root is reset.
+         */
+        StringView getString(StringView key)
+        {
+            const result &res = (*this)[key];
+
+            if(res.type != STRING)
+                throw Error(SARG_ERR_INVALARG);
+            if(!res.str_val)
+                return StringView();
+            return StringView(res.str_val);
+        }
+
+        /**
+         * Parses the given arguments without throwing. On failure the
+         * status holds the index and value of the offending argument.
+         */
+        Status tryParse(const char **argv, const int argc)
         {
             int ret;
+            int idx;
 
             ret = sarg_parse(&root_, argv, argc);
-            if(ret != SARG_ERR_SUCCESS)
-                throw Error(ret);
+            if(ret != SARG_ERR_SUCCESS) {
+                idx = root_.err_idx;
+                if(idx < 0)
+                    return ruleStatus(ret);
+                return Status(ret, idx,
+                    idx >= 0 && idx < argc ? argv[idx] : NULL);
+            }
+
+            return Status();
+        }
+
+        void parse(const char **argv, const int argc)
+        {
+            Status status = tryParse(argv, argc);
+            if(!status)
+                throw Error(status);
+        }
+
+        /**
+         * Parses the given arguments, the first one being the program
+         * name, without throwing.
+         */
+        Status tryParse(ArgSpan args)
+        {
+            return tryParse(args.data(), static_cast<int>(args.size()));
+        }
+
+        void parse(ArgSpan args)
+        {
+            parse(args.data(), static_cast<int>(args.size()));
+        }
+
+        /**
+         * Parses a shell-like command line without throwing. On failure
+         * the status holds the offset of the offending argument and
+         * views it within cmdline, see Status::tokenLength.
+         */
+        Status tryParse(StringView cmdline)
+        {
+            int ret;
+            int idx;
+
+            ret = sarg_parse_string_n(&root_, cmdline.data(), cmdline.size());
+            if(ret != SARG_ERR_SUCCESS) {
+                idx = root_.err_idx;
+                if(idx < 0)
+                    return ruleStatus(ret);
+                return Status(ret, idx, StringView(cmdline.data() + idx,
+                    argLength(cmdline, static_cast<size_t>(idx))));
+            }
+
+            return Status();
+        }
+
+        void parse(StringView cmdline)
+        {
+            Status status = tryParse(cmdline);
+            if(!status)
+                throw Error(status);
+        }
+
+        /**
+         * Resets all results, so the root can parse again without
+         * reallocating its memory.
+         */
+        void reset()
+        {
+            if(init_)
+                sarg_reset(&root_);
+        }
+
+        /**
+         * Indices of the positional arguments in the argv of the last
+         * parse, see sarg_positionals. The array holds
+         * positionalCount() entries.
+         */
+        const int *positionals()
+        {
+            const int *indices;
+
+            sarg_positionals(&root_, &indices);
+            return indices;
+        }
+
+        int positionalCount()
+        {
+            return sarg_positionals(&root_, NULL);
         }
 
 #ifndef SARG_NO_PRINT
-        std::string getHelp()
+        /**
+         * Help text without copying it. The text is built once and
+         * kept by the root, because the options do not change after
+         * init().
+         */
+        StringView helpText()
         {
-            std::string result;
-            char *text;
             int ret;
 
-            ret = sarg_help_text(&root_, &text);
-            if(ret != SARG_ERR_SUCCESS)
-                throw Error(ret);
+            if(!help_) {
+                ret = sarg_help_text(&root_, &help_);
+                if(ret != SARG_ERR_SUCCESS)
+                    throw Error(ret);
+            }
 
-            result = std::string(text);
-            free(text);
+            return StringView(help_);
+        }
 
-            return result;
+        std::string getHelp()
+        {
+            StringView text = helpText();
+
+            return std::string(text.data(), text.size());
         }
 
         void printHelp()
@@ -194,17 +1003,42 @@ namespace sarg
             if(ret != SARG_ERR_SUCCESS)
                 throw Error(ret);
         }
+
+        /**
+         * Serializes the results, see sarg_dump.
+         */
+        std::string dump(const int format = SARG_DUMP_JSON,
+            const unsigned int flags = 0)
+        {
+            std::string result;
+            char *text;
+            int ret;
+
+            ret = sarg_dump_text(&root_, format, flags, &text);
+            if(ret != SARG_ERR_SUCCESS)
+                throw Error(ret);
+
+            result = std::string(text);
+            sarg_free_text(&root_, text);
+
+            return result;
+        }
 #endif
 
 #ifndef SARG_NO_FILE
-        void fromFile(const std::string &filename)
+        void fromFile(const char *filename)
         {
             int ret;
 
-            ret = sarg_parse_file(&root_, filename.c_str());
+            ret = sarg_parse_file(&root_, filename);
             if(ret != SARG_ERR_SUCCESS)
                 throw Error(ret);
         }
+
+        void fromFile(const std::string &filename)
+        {
+            fromFile(filename.c_str());
+        }
 #endif
     };
 }
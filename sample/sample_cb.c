@@ -7,6 +7,8 @@
 
 #include <smallargs.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
@@ -0,0 +1,50 @@
+/*
+ * sample_gen.cpp
+ *
+ * Example on how to use the code generated by sarg_gen from
+ * sample_gen.spec. The option table, lookup and help text are
+ * constants, the values end up in typed fields.
+ */
+
+#include "sample_gen.hpp"
+#include <iostream>
+
+int main(const int argc, const char **argv)
+{
+    sample_args args;
+    sarg::Status status;
+    int i;
+
+    status = args.parse(argv, argc);
+    if(!status) {
+        std::cout << "Parsing failed: " << sarg_strerror(status.errval()) << std::endl;
+        std::cout << sample_help;
+        return -1;
+    }
+
+    if(args.help) {
+        std::cout << sample_help;
+        return 0;
+    }
+
+    std::cout << "verbosity set to " << args.counts[SAMPLE_VERBOSE] << std::endl;
+
+    if(args.counts[SAMPLE_COUNT] > 0) {
+        std::cout << "counting: ";
+        for(i = 0; i < args.count; ++i) {
+            std::cout << i + 1;
+            if(i + 1 != args.count)
+                std::cout << ",";
+        }
+        std::cout << std::endl;
+    }
+
+    if(!args.say.empty())
+        std::cout << args.say << std::endl;
+    if(args.max_size > 0)
+        std::cout << "max size " << args.max_size << " bytes" << std::endl;
+    if(args.timeout > 0)
+        std::cout << "timeout " << args.timeout << "ns" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+# Options of sarg_sample_gen_cpp, compiled by sarg_gen into
+# sample_gen.h and sample_gen.hpp.
+
+--program sarg_sample_gen
+--short h --long help --type BOOL --text "show help text"
+--short v --long verbose --type BOOL --text "increase verbosity"
+--short c --long count --type INT --text "count up to this number"
+--long say --type STRING --text "print the given text"
+--long max-size --type SIZE --text "largest accepted input" --field max_size
+--short t --long timeout --type DURATION --text "give up after this time"
@@ -24,7 +24,8 @@ int main(int argc, const char **argv)
 {
     sarg_root root;
     sarg_result *res;
-    int i;
+    const int *pos;
+    int i, len;
 
     int ret = sarg_init(&root, my_opts, "sarg_sample_c");
     assert(ret == SARG_ERR_SUCCESS);
@@ -95,6 +96,11 @@ int main(int argc, const char **argv)
         printf("you say: %s\n", res->str_val);
     }
 
+    // list the remaining arguments
+    len = sarg_positionals(&root, &pos);
+    for(i = 0; i < len; ++i)
+        printf("argument: %s\n", argv[pos[i]]);
+
     sarg_destroy(&root);
 
     return 0;
@@ -72,5 +72,9 @@ int main(const int argc, const char **argv)
     if(root["say"].count > 0)
         std::cout << "you say: " << root["say"].str_val << std::endl;
 
+    // list the remaining arguments
+    for(i = 0; i < root.positionalCount(); ++i)
+        std::cout << "argument: " << argv[root.positionals()[i]] << std::endl;
+
     return 0;
 }
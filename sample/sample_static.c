@@ -0,0 +1,91 @@
+/*
+ * sample_static.c
+ *
+ * Example on how to parse arguments without any heap allocation.
+ * Compile with SARG_NO_MALLOC defined. The library is built without it,
+ * so this file compiles the implementation itself.
+ */
+
+#define SARG_IMPLEMENTATION
+#include <smallargs.h>
+#include <stdio.h>
+#include <assert.h>
+
+#define OPT_COUNT 4
+
+static const sarg_opt my_opts[] = {
+    {"h", "help", "show help text", BOOL, NULL},
+    {"v", "verbose", "increase verbosity", BOOL, NULL},
+    {"c", "count", "count up to this number", INT, NULL},
+    {NULL, "say", "print the given text", STRING, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+static sarg_result my_results[OPT_COUNT];
+static char my_strings[256];
+static char my_help[512];
+
+int main(int argc, const char **argv)
+{
+    sarg_root root;
+    sarg_result *res;
+    sarg_storage storage;
+    int i;
+
+    storage.results = my_results;
+    storage.res_len = OPT_COUNT;
+    storage.str_buf = my_strings;
+    storage.str_len = sizeof(my_strings);
+    storage.help_buf = my_help;
+    storage.help_len = sizeof(my_help);
+    storage.pos_buf = NULL;
+    storage.pos_len = 0;
+
+    int ret = sarg_init_static(&root, my_opts, "sarg_sample_static", &storage);
+    assert(ret == SARG_ERR_SUCCESS);
+
+    ret = sarg_parse(&root, argv, argc);
+    if(ret != SARG_ERR_SUCCESS) {
+        printf("Parsing failed\n");
+        sarg_help_print(&root);
+        sarg_destroy(&root);
+        return -1;
+    }
+
+    // check if help flag was set
+    ret = sarg_get(&root, "help", &res);
+    assert(ret == SARG_ERR_SUCCESS);
+    if(res->bool_val) {
+        sarg_help_print(&root);
+        sarg_destroy(&root);
+        return 0;
+    }
+
+    // check for verbosity
+    ret = sarg_get(&root, "v", &res);
+    assert(ret == SARG_ERR_SUCCESS);
+    printf("verbosity set to %d\n", res->count);
+
+    // count to the given number
+    ret = sarg_get(&root, "count", &res);
+    assert(ret == SARG_ERR_SUCCESS);
+    if(res->count > 0) {
+        printf("counting: ");
+        for(i = 0; i < res->int_val; ++i) {
+            printf("%d", i + 1);
+            if(i + 1 != res->int_val)
+                printf(",");
+        }
+        printf("\n");
+    }
+
+    // say something, the string lives in my_strings
+    ret = sarg_get(&root, "say", &res);
+    assert(ret == SARG_ERR_SUCCESS);
+    if(res->count > 0)
+        printf("you say: %s\n", res->str_val);
+
+    sarg_destroy(&root);
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+/*
+ * smallargs.c
+ *
+ * Compiles the implementation of smallargs.h once, so that programs can
+ * link the smallargs library instead of defining SARG_IMPLEMENTATION.
+ */
+
+#define SARG_IMPLEMENTATION
+#include "smallargs.h"
@@ -0,0 +1,264 @@
+/*
+ * bench_smallargs.c
+ *
+ * Throughput benchmarks for option lookup and parsing on schemas of
+ * growing size. Only the public interface is used, so the same file
+ * can be compiled against an older smallargs.h to compare revisions:
+ *
+ *   cc -O2 -I<old>/include test/bench/bench_smallargs.c -o bench_old
+ *
+ * Every workload is run several times and the best time per operation
+ * is printed. Pass the name of a workload to run only that one. The file
+ * workloads write their argument files into the working directory.
+ */
+
+#define SARG_IMPLEMENTATION
+
+#include <smallargs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEAT 5
+#define MIN_SAMPLE_TIME 0.05
+#define MAX_OPTS 4096
+#define LOOKUPS 4096
+#define FILES 8
+
+typedef struct _bench_case {
+    const char *name;
+    // runs the workload once and returns the number of operations
+    long (*func)(int n);
+    // optional, prepare and release the input of each size
+    void (*setup)(int n);
+    void (*teardown)(void);
+} bench_case;
+
+static char opt_names[MAX_OPTS][16];
+static char opt_args[MAX_OPTS][18];
+static sarg_opt many_opts[MAX_OPTS + 1];
+static const char *argv_buf[1 + 2 * MAX_OPTS];
+static sarg_root bench_root;
+static char file_names[FILES][32];
+static sarg_root file_roots[FILES];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fail(const char *what, int ret)
+{
+    fprintf(stderr, "%s failed: %d\n", what, ret);
+    exit(EXIT_FAILURE);
+}
+
+static void init_opts(int n)
+{
+    int i;
+
+    for(i = 0; i < n; ++i) {
+        snprintf(opt_names[i], sizeof(opt_names[i]), "opt%d", i);
+        snprintf(opt_args[i], sizeof(opt_args[i]), "--opt%d", i);
+        many_opts[i].short_name = NULL;
+        many_opts[i].long_name = opt_names[i];
+        many_opts[i].help = "help text of a generated option";
+        // types that every revision knows
+        many_opts[i].type = (sarg_opt_type) (i % (STRING + 1));
+        many_opts[i].callback = NULL;
+    }
+    memset(&many_opts[n], 0, sizeof(sarg_opt));
+}
+
+/* ==========================================================
+ * Workloads
+ * ========================================================== */
+
+static long bench_init(int n)
+{
+    sarg_root root;
+
+    int ret = sarg_init(&root, many_opts, "bench");
+    if(ret != SARG_ERR_SUCCESS)
+        fail("sarg_init", ret);
+    sarg_destroy(&root);
+
+    return n;
+}
+
+static long bench_lookup(int n)
+{
+    sarg_result *res;
+    int i, ret;
+
+    // scattered names, so that the whole table is touched
+    for(i = 0; i < LOOKUPS; ++i) {
+        ret = sarg_get(&bench_root, opt_names[(i * 7919) % n], &res);
+        if(ret != SARG_ERR_SUCCESS)
+            fail("sarg_get", ret);
+    }
+
+    return LOOKUPS;
+}
+
+static long bench_parse(int n)
+{
+    static const char *values[] = {"-12", "0x1f", "1.5", NULL, "text"};
+    int i, argc, ret;
+
+    argc = 0;
+    argv_buf[argc++] = "bench";
+    for(i = 0; i < n; ++i) {
+        argv_buf[argc++] = opt_args[(i * 7919) % n];
+        if(values[many_opts[(i * 7919) % n].type] != NULL)
+            argv_buf[argc++] = values[many_opts[(i * 7919) % n].type];
+    }
+
+    ret = sarg_parse(&bench_root, argv_buf, argc);
+    if(ret != SARG_ERR_SUCCESS)
+        fail("sarg_parse", ret);
+
+    return n;
+}
+
+static void write_files(int n)
+{
+    static const char *values[] = {"-12", "0x1f", "1.5", NULL, "some text"};
+    const sarg_opt *opt;
+    FILE *fp;
+    int i, f, ret;
+
+    for(f = 0; f < FILES; ++f) {
+        snprintf(file_names[f], sizeof(file_names[f]), "sarg_bench_%d.txt", f);
+        fp = fopen(file_names[f], "w");
+        if(!fp)
+            fail("fopen", -1);
+
+        for(i = 0; i < n; ++i) {
+            opt = &many_opts[(i * 7919 + f) % n];
+            if(values[opt->type] != NULL)
+                fprintf(fp, "%s %s\n", opt->long_name, values[opt->type]);
+            else
+                fprintf(fp, "%s\n", opt->long_name);
+        }
+        fclose(fp);
+
+        ret = sarg_init(&file_roots[f], many_opts, "bench");
+        if(ret != SARG_ERR_SUCCESS)
+            fail("sarg_init", ret);
+    }
+}
+
+static void remove_files(void)
+{
+    int f;
+
+    for(f = 0; f < FILES; ++f) {
+        sarg_destroy(&file_roots[f]);
+        remove(file_names[f]);
+    }
+}
+
+static long bench_file(int n)
+{
+    int ret = sarg_parse_file(&bench_root, file_names[0]);
+    if(ret != SARG_ERR_SUCCESS)
+        fail("sarg_parse_file", ret);
+
+    return n;
+}
+
+// sarg_parse_files is only available where SARG_MAX_THREADS is defined
+#ifdef SARG_MAX_THREADS
+
+static long bench_files(int n)
+{
+    sarg_file_job jobs[FILES];
+    int f, ret;
+
+    for(f = 0; f < FILES; ++f) {
+        jobs[f].root = &file_roots[f];
+        jobs[f].filename = file_names[f];
+    }
+
+    ret = sarg_parse_files(jobs, FILES, 0);
+    if(ret != SARG_ERR_SUCCESS)
+        fail("sarg_parse_files", ret);
+
+    return (long) FILES * n;
+}
+
+#endif
+
+static const bench_case cases[] = {
+    {"init", bench_init, NULL, NULL},
+    {"lookup", bench_lookup, NULL, NULL},
+    {"parse", bench_parse, NULL, NULL},
+    {"file", bench_file, write_files, remove_files},
+#ifdef SARG_MAX_THREADS
+    {"files", bench_files, write_files, remove_files},
+#endif
+    {NULL, NULL, NULL, NULL}
+};
+
+static const int sizes[] = {16, 256, MAX_OPTS};
+
+/* ==========================================================
+ * Driver
+ * ========================================================== */
+
+static double measure(const bench_case *bench, int n)
+{
+    double start, time, best;
+    long ops;
+    int i;
+
+    best = 0;
+    for(i = 0; i < REPEAT; ++i) {
+        ops = 0;
+        start = now();
+        // repeat short workloads to get above the timer noise
+        do {
+            ops += bench->func(n);
+            time = now() - start;
+        } while(time < MIN_SAMPLE_TIME);
+
+        time /= ops;
+        if(i == 0 || time < best)
+            best = time;
+    }
+
+    return best;
+}
+
+int main(int argc, const char *argv[])
+{
+    const bench_case *bench;
+    int i, ret;
+
+    printf("%-8s %6s %12s\n", "workload", "opts", "ns/op");
+    for(bench = cases; bench->name != NULL; ++bench) {
+        if(argc > 1 && strcmp(argv[1], bench->name) != 0)
+            continue;
+
+        for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); ++i) {
+            init_opts(sizes[i]);
+            ret = sarg_init(&bench_root, many_opts, "bench");
+            if(ret != SARG_ERR_SUCCESS)
+                fail("sarg_init", ret);
+            if(bench->setup)
+                bench->setup(sizes[i]);
+
+            printf("%-8s %6d %12.1f\n", bench->name, sizes[i],
+                   measure(bench, sizes[i]) * 1e9);
+            if(bench->teardown)
+                bench->teardown();
+            sarg_destroy(&bench_root);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
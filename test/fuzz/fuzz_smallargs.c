@@ -0,0 +1,311 @@
+/*
+ * fuzz_smallargs.c
+ *
+ * Fuzz target for sarg_parse, sarg_parse_string, sarg_parse_file,
+ * sarg_parse_ini, sarg_parse_json and sarg_help_text.
+ *
+ * Built with SARG_FUZZ_LIBFUZZER this file only provides the
+ * libFuzzer entry point. Otherwise a standalone driver is compiled
+ * which either replays the given input files or runs a fixed number
+ * of pseudo random inputs.
+ */
+
+#define SARG_IMPLEMENTATION
+#include <smallargs.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FUZZ_MAX_TOKENS 256
+#define FUZZ_MODE_PARSE 0
+#define FUZZ_MODE_FILE  1
+#define FUZZ_MODE_HELP  2
+#define FUZZ_MODE_CMDLINE 3
+#define FUZZ_MODE_INI 4
+#define FUZZ_MODE_JSON 5
+#define FUZZ_MODE_COUNT 6
+
+static sarg_opt fuzz_opts[] = {
+    {"i", "int", "int value", INT, NULL},
+    {"u", "uint", "uint value", UINT, NULL},
+    {"d", "double", "double value", DOUBLE, NULL},
+    {"b", "bool", "bool value", BOOL, NULL},
+    {"s", "str", "string value", STRING, NULL},
+    {NULL, "long-only", NULL, STRING, NULL},
+    {"x", NULL, NULL, INT, NULL},
+    {"m", "mode", NULL, ENUM, NULL},
+    {"z", "size", NULL, SIZE, NULL},
+    {"t", "time", NULL, DURATION, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+static const char *fuzz_modes[] = {"fast", "safe", "debug", NULL};
+
+static int fuzz_init(sarg_root *root)
+{
+    if(sarg_init(root, fuzz_opts, "fuzz") != SARG_ERR_SUCCESS)
+        return -1;
+    if(sarg_set_choices(root, "mode", fuzz_modes) != SARG_ERR_SUCCESS
+       || sarg_set_range(root, "x", -100, 100) != SARG_ERR_SUCCESS) {
+        sarg_destroy(root);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Splits the data at newlines and NUL bytes into NUL-terminated
+ * tokens. Returns the number of tokens written to tokens.
+ */
+static int fuzz_tokenize(char *buf, size_t len, char **tokens, int max_tokens)
+{
+    size_t i, start;
+    int count;
+
+    count = 0;
+    start = 0;
+    for(i = 0; i <= len && count < max_tokens; ++i) {
+        if(i == len || buf[i] == '\n' || buf[i] == '\0') {
+            buf[i] = '\0';
+            tokens[count++] = &buf[start];
+            start = i + 1;
+        }
+    }
+
+    return count;
+}
+
+static void fuzz_parse(char *buf, size_t len)
+{
+    char *argv[FUZZ_MAX_TOKENS + 1];
+    sarg_root root;
+    int argc;
+
+    argv[0] = "fuzz";
+    argc = 1 + fuzz_tokenize(buf, len, &argv[1], FUZZ_MAX_TOKENS);
+
+    if(fuzz_init(&root) != 0)
+        return;
+    sarg_parse(&root, (const char **) argv, argc);
+    sarg_destroy(&root);
+}
+
+static void fuzz_cmdline(char *buf, size_t len)
+{
+    sarg_root root;
+
+    buf[len] = '\0';
+    if(fuzz_init(&root) != 0)
+        return;
+    sarg_parse_string(&root, buf);
+    sarg_destroy(&root);
+}
+
+static void fuzz_config(const char *buf, size_t len, int mode)
+{
+    sarg_root root;
+
+    if(fuzz_init(&root) != 0)
+        return;
+    if(mode == FUZZ_MODE_INI)
+        sarg_parse_ini(&root, buf, len);
+    else
+        sarg_parse_json(&root, buf, len);
+    sarg_destroy(&root);
+}
+
+#ifndef SARG_NO_FILE
+static void fuzz_file(const char *buf, size_t len)
+{
+    char filename[] = "/tmp/sarg_fuzz_XXXXXX";
+    sarg_root root;
+    int fd;
+
+    fd = mkstemp(filename);
+    if(fd < 0)
+        return;
+    if(write(fd, buf, len) == (ssize_t) len
+       && fuzz_init(&root) == 0) {
+        sarg_parse_file(&root, filename);
+        sarg_destroy(&root);
+    }
+    close(fd);
+    unlink(filename);
+}
+#endif
+
+#ifndef SARG_NO_PRINT
+static void fuzz_help(char *buf, size_t len)
+{
+    char *tokens[FUZZ_MAX_TOKENS];
+    sarg_opt opts[FUZZ_MAX_TOKENS + 1];
+    sarg_root root;
+    char *text;
+    int i, count, opt_len;
+
+    count = fuzz_tokenize(buf, len, tokens, FUZZ_MAX_TOKENS);
+
+    // every non empty token becomes an option, the first char decides
+    // on type and whether it has a short or long name
+    opt_len = 0;
+    for(i = 0; i < count; ++i) {
+        if(tokens[i][0] == '\0')
+            continue;
+        opts[opt_len].short_name = (tokens[i][0] & 1) ? tokens[i] : NULL;
+        opts[opt_len].long_name = (tokens[i][0] & 2) ? tokens[i] : NULL;
+        if(!opts[opt_len].short_name && !opts[opt_len].long_name)
+            opts[opt_len].long_name = tokens[i];
+        opts[opt_len].help = (tokens[i][0] & 4) ? tokens[i] : NULL;
+        opts[opt_len].type = (sarg_opt_type) ((unsigned char) tokens[i][0] % COUNT);
+        opts[opt_len].callback = NULL;
+        ++opt_len;
+    }
+    memset(&opts[opt_len], 0, sizeof(sarg_opt));
+
+    if(sarg_init(&root, opts, count > 0 ? tokens[0] : "") != SARG_ERR_SUCCESS)
+        return;
+    if(sarg_help_text(&root, &text) == SARG_ERR_SUCCESS)
+        sarg_free_text(&root, text);
+    sarg_destroy(&root);
+}
+#endif
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char *buf;
+
+    if(size < 1)
+        return 0;
+
+    // keep a private, writable copy of the input
+    buf = (char *) malloc(size);
+    if(!buf)
+        return 0;
+    memcpy(buf, data + 1, size - 1);
+
+    switch(data[0] % FUZZ_MODE_COUNT) {
+    case FUZZ_MODE_PARSE:
+        fuzz_parse(buf, size - 1);
+        break;
+    case FUZZ_MODE_CMDLINE:
+        fuzz_cmdline(buf, size - 1);
+        break;
+    case FUZZ_MODE_INI:
+    case FUZZ_MODE_JSON:
+        fuzz_config(buf, size - 1, data[0] % FUZZ_MODE_COUNT);
+        break;
+#ifndef SARG_NO_FILE
+    case FUZZ_MODE_FILE:
+        fuzz_file(buf, size - 1);
+        break;
+#endif
+#ifndef SARG_NO_PRINT
+    case FUZZ_MODE_HELP:
+        fuzz_help(buf, size - 1);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    free(buf);
+    return 0;
+}
+
+#ifndef SARG_FUZZ_LIBFUZZER
+
+#define FUZZ_DEFAULT_RUNS 20000
+#define FUZZ_MAX_INPUT 4096
+
+static const char *fuzz_fragments[] = {
+    "-", "--", "i", "int", "u", "uint", "d", "double", "b", "bool",
+    "s", "str", "long-only", "x", "0x", "0", "7", "-1", "1.5e3", "abc",
+    " ", "  ", "\n", "\n\n", "\t", "\0", "=", "\"", "%s", "%n",
+    "'", "\\", "$", "[", "]", "{", "}", ":", ",", "#", ";", "\"int\"",
+    "\\u", "d83d", "true", "null", "[long-only]", "m", "mode", "fast",
+    "debug", "100", "101", "z", "size", "t", "time", "Gi", "M", "ms", "h",
+    ".5", "18446744073709551615"
+};
+
+#define FUZZ_FRAGMENT_COUNT \
+    ((int) (sizeof(fuzz_fragments) / sizeof(fuzz_fragments[0])))
+
+static int fuzz_file_input(const char *filename)
+{
+    uint8_t buf[FUZZ_MAX_INPUT];
+    size_t len;
+    FILE *fp;
+
+    fp = fopen(filename, "rb");
+    if(!fp) {
+        fprintf(stderr, "cannot open %s\n", filename);
+        return -1;
+    }
+    len = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+
+    LLVMFuzzerTestOneInput(buf, len);
+    return 0;
+}
+
+static void fuzz_random_input(unsigned int *seed)
+{
+    uint8_t buf[FUZZ_MAX_INPUT];
+    size_t len, frag_len;
+    const char *frag;
+    int i, parts;
+
+    len = 0;
+    buf[len++] = (uint8_t) rand_r(seed);
+    parts = rand_r(seed) % 64;
+    for(i = 0; i < parts; ++i) {
+        if(rand_r(seed) % 8 == 0) {
+            // raw random byte
+            frag = NULL;
+            frag_len = 1;
+        } else {
+            frag = fuzz_fragments[rand_r(seed) % FUZZ_FRAGMENT_COUNT];
+            frag_len = frag[0] == '\0' ? 1 : strlen(frag);
+        }
+        if(len + frag_len > sizeof(buf))
+            break;
+        if(frag)
+            memcpy(&buf[len], frag, frag_len);
+        else
+            buf[len] = (uint8_t) rand_r(seed);
+        len += frag_len;
+    }
+
+    LLVMFuzzerTestOneInput(buf, len);
+}
+
+int main(int argc, const char **argv)
+{
+    unsigned int seed;
+    int i, runs;
+
+    // replay given inputs, e.g. a crash reproducer or a corpus
+    if(argc > 1 && strcmp(argv[1], "-runs") != 0) {
+        for(i = 1; i < argc; ++i) {
+            if(fuzz_file_input(argv[i]) != 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    runs = FUZZ_DEFAULT_RUNS;
+    if(argc > 2)
+        runs = atoi(argv[2]);
+
+    seed = 42;
+    for(i = 0; i < runs; ++i)
+        fuzz_random_input(&seed);
+
+    printf("%d fuzz runs done\n", runs);
+    return 0;
+}
+
+#endif
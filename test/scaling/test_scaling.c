@@ -0,0 +1,393 @@
+/*
+ * test_scaling.c
+ *
+ * Scaling tests that double the input size and check that the number
+ * of allocations grows roughly linearly. Run times are printed, but
+ * only checked if SCALING_CHECK_TIME is defined, see the
+ * sarg_test_scaling_time target, since they depend on the machine load.
+ */
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+static long alloc_count = 0;
+
+static void *count_malloc(size_t size)
+{
+    ++alloc_count;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ptr, size_t size)
+{
+    ++alloc_count;
+    return realloc(ptr, size);
+}
+
+// route all allocations of smallargs through the counter
+#define SARG_IMPLEMENTATION
+#define malloc count_malloc
+#define realloc count_realloc
+#include <smallargs.h>
+#undef realloc
+#undef malloc
+
+#include <ctest.h>
+
+int main(int argc, const char *argv[])
+{
+    return ctest_main(argc, argv);
+}
+
+#define UNUSED(e) ((void) e)
+
+// linear growth doubles the cost, quadratic growth quadruples it
+#define MAX_TIME_RATIO 3.0
+#define MAX_ALLOC_RATIO 2.5
+#define REPEAT 7
+#define MIN_SAMPLE_TIME 0.01
+#define MAX_OPTS 4096
+
+typedef void (*scale_func)(int n);
+
+typedef struct _scale_sample {
+    double time;
+    long allocs;
+} scale_sample;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static scale_sample measure_once(scale_func func, int n)
+{
+    scale_sample sample;
+    double start;
+    int runs;
+
+    alloc_count = 0;
+    runs = 0;
+    start = now();
+    // repeat short workloads to get above the timer noise
+    do {
+        func(n);
+        ++runs;
+        sample.time = now() - start;
+    } while(sample.time < MIN_SAMPLE_TIME);
+
+    sample.time /= runs;
+    sample.allocs = alloc_count / runs;
+
+    return sample;
+}
+
+static void check_samples(scale_sample small, scale_sample large)
+{
+    printf("  small: %.6fs %ld allocs, large: %.6fs %ld allocs\n",
+           small.time, small.allocs, large.time, large.allocs);
+
+#ifdef SCALING_CHECK_TIME
+    ASSERT_TRUE(large.time <= MAX_TIME_RATIO * small.time);
+#endif
+    ASSERT_TRUE(large.allocs <= MAX_ALLOC_RATIO * small.allocs + 8);
+}
+
+static void check_linear(scale_func func, int n)
+{
+    scale_sample small, large, sample;
+    int i;
+
+    // alternate both sizes, so that both see the same disturbances,
+    // and keep the best run of each
+    for(i = 0; i < REPEAT; ++i) {
+        sample = measure_once(func, n);
+        if(i == 0 || sample.time < small.time)
+            small = sample;
+        sample = measure_once(func, 2 * n);
+        if(i == 0 || sample.time < large.time)
+            large = sample;
+    }
+
+    check_samples(small, large);
+}
+
+/* ==========================================================
+ * Fixtures
+ * ========================================================== */
+
+static sarg_opt scale_opts[] = {
+    {"i", "int", "int value", INT, NULL},
+    {"u", "uint", "uint value", UINT, NULL},
+    {"d", "double", "double value", DOUBLE, NULL},
+    {"b", "bool", "bool value", BOOL, NULL},
+    {"s", "str", "string value", STRING, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+static const char *scale_tokens[] = {
+    "-i", "-1234", "--uint", "0x1f", "-d", "3.14",
+    "--bool", "-s", "some string value"
+};
+
+#define SCALE_TOKEN_COUNT 9
+
+static char opt_names[MAX_OPTS][16];
+static sarg_opt many_opts[MAX_OPTS + 1];
+
+static int init_many_opts(sarg_root *root, int n)
+{
+    int i;
+
+    for(i = 0; i < n; ++i) {
+        snprintf(opt_names[i], sizeof(opt_names[i]), "opt%d", i);
+        many_opts[i].short_name = NULL;
+        many_opts[i].long_name = opt_names[i];
+        many_opts[i].help = "help text of a generated option";
+        many_opts[i].type = (sarg_opt_type) (i % COUNT);
+        many_opts[i].callback = NULL;
+    }
+    memset(&many_opts[n], 0, sizeof(sarg_opt));
+
+    return sarg_init(root, many_opts, "scale");
+}
+
+/* ==========================================================
+ * Workloads
+ * ========================================================== */
+
+static void parse_argv(int n)
+{
+    static const char *argv[1 + 64 * SCALE_TOKEN_COUNT * 1024];
+    sarg_root root;
+    int i, argc;
+
+    argc = 1;
+    argv[0] = "scale";
+    for(i = 0; i < n; ++i) {
+        memcpy(&argv[argc], scale_tokens, sizeof(scale_tokens));
+        argc += SCALE_TOKEN_COUNT;
+    }
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, argc));
+    sarg_destroy(&root);
+}
+
+static void parse_positionals(int n)
+{
+    static const char *argv[1 + 2 * 64 * 1024];
+    sarg_root root;
+    int i, argc;
+
+    argc = 1;
+    argv[0] = "scale";
+    for(i = 0; i < n; ++i) {
+        argv[argc++] = "some/path/to/a/file.txt";
+        argv[argc++] = i == n / 2 ? "--" : "-b";
+    }
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, argc));
+    ASSERT_TRUE(sarg_positionals(&root, NULL) > n);
+    sarg_destroy(&root);
+}
+
+#ifndef SARG_NO_FILE
+
+#define SCALE_FILE "sarg_scaling_args.txt"
+
+static void write_file(int n)
+{
+    FILE *fp;
+    int i;
+
+    fp = fopen(SCALE_FILE, "w");
+    ASSERT_NOT_NULL(fp);
+    for(i = 0; i < n; ++i) {
+        // mix short, long and padded lines
+        fprintf(fp, "i %d\n", i);
+        fprintf(fp, "  uint 0x%x  \n", i);
+        fprintf(fp, "double %d.5\n", i);
+        fprintf(fp, "bool\n\n");
+        fprintf(fp, "str %*s\n", i % 64 + 1, "x");
+    }
+    fclose(fp);
+}
+
+static void parse_file(int n)
+{
+    sarg_root root;
+    UNUSED(n);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_file(&root, SCALE_FILE));
+    sarg_destroy(&root);
+}
+
+#endif
+
+static char text_buf[64 * 64 * 1024];
+
+static void parse_ini(int n)
+{
+    sarg_root root;
+    size_t len;
+    int i;
+
+    len = 0;
+    for(i = 0; i < n; ++i) {
+        len += snprintf(&text_buf[len], sizeof(text_buf) - len,
+                        "# entry %d\nint = %d\n  uint=0x%x ; hex\n"
+                        "double = %d.5\nbool = %s\nstr = \"%*s\"\n",
+                        i, i, i, i, i % 2 ? "yes" : "no", i % 32 + 1, "x");
+    }
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_ini(&root, text_buf, len));
+    sarg_destroy(&root);
+}
+
+static void parse_json(int n)
+{
+    sarg_root root;
+    size_t len;
+    int i;
+
+    len = snprintf(text_buf, sizeof(text_buf), "{");
+    for(i = 0; i < n; ++i)
+        len += snprintf(&text_buf[len], sizeof(text_buf) - len,
+                        "\"int\": %d, \"str\": \"value \\\"%d\\\"\", ", i, i);
+    len += snprintf(&text_buf[len], sizeof(text_buf) - len, "\"bool\": true}");
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_json(&root, text_buf, len));
+    sarg_destroy(&root);
+}
+
+static void lookup_opts(int n)
+{
+    sarg_root root;
+    sarg_result *res;
+    int i;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, init_many_opts(&root, n));
+    // fixed number of lookups, growing schema
+    for(i = 0; i < 1024; ++i)
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, opt_names[(i * 7) % n], &res));
+    sarg_destroy(&root);
+}
+
+#ifndef SARG_NO_PRINT
+
+static void help_text(int n)
+{
+    sarg_root root;
+    char *text;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, init_many_opts(&root, n));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_help_text(&root, &text));
+    sarg_free_text(&root, text);
+    sarg_destroy(&root);
+}
+
+#endif
+
+/* ==========================================================
+ * Scaling Tests
+ * ========================================================== */
+
+CTEST(scaling, parse_argv)
+{
+    check_linear(parse_argv, 8 * 1024);
+    check_linear(parse_argv, 16 * 1024);
+}
+
+CTEST(scaling, parse_positionals)
+{
+    check_linear(parse_positionals, 16 * 1024);
+    check_linear(parse_positionals, 32 * 1024);
+}
+
+#ifndef SARG_NO_FILE
+
+CTEST(scaling, parse_file)
+{
+    scale_sample small, large;
+    int i;
+
+    // parse_file ignores n, so sample the two sizes separately
+    write_file(8 * 1024);
+    for(i = 0; i < REPEAT; ++i) {
+        scale_sample sample = measure_once(parse_file, 0);
+        if(i == 0 || sample.time < small.time)
+            small = sample;
+    }
+    write_file(16 * 1024);
+    for(i = 0; i < REPEAT; ++i) {
+        scale_sample sample = measure_once(parse_file, 0);
+        if(i == 0 || sample.time < large.time)
+            large = sample;
+    }
+    remove(SCALE_FILE);
+
+    check_samples(small, large);
+}
+
+#endif
+
+CTEST(scaling, parse_ini)
+{
+    check_linear(parse_ini, 4 * 1024);
+    check_linear(parse_ini, 8 * 1024);
+}
+
+CTEST(scaling, parse_json)
+{
+    check_linear(parse_json, 8 * 1024);
+    check_linear(parse_json, 16 * 1024);
+}
+
+CTEST(scaling, lookup)
+{
+    check_linear(lookup_opts, MAX_OPTS / 4);
+    check_linear(lookup_opts, MAX_OPTS / 2);
+}
+
+CTEST(scaling, reset_reuse)
+{
+    const char *argv[1 + SCALE_TOKEN_COUNT];
+    sarg_root root;
+    int i;
+
+    argv[0] = "scale";
+    memcpy(&argv[1], scale_tokens, sizeof(scale_tokens));
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, scale_opts, "scale"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, 1 + SCALE_TOKEN_COUNT));
+
+    // once warmed up, repeated parses do not allocate
+    alloc_count = 0;
+    for(i = 0; i < 1000; ++i) {
+        sarg_reset(&root);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, 1 + SCALE_TOKEN_COUNT));
+    }
+    ASSERT_EQUAL(0, alloc_count);
+    sarg_destroy(&root);
+}
+
+#ifndef SARG_NO_PRINT
+
+CTEST(scaling, help_text)
+{
+    check_linear(help_text, MAX_OPTS / 4);
+    check_linear(help_text, MAX_OPTS / 2);
+}
+
+#endif
@@ -7,11 +7,14 @@
 
 #define CTEST_MAIN
 #define CTEST_SEGFAULT
+#define SARG_IMPLEMENTATION
 
 #include <limits.h>
+#include <locale.h>
 #include <smallargs.h>
 #include <ctest.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 int main(int argc, const char *argv[])
 {
@@ -82,6 +85,81 @@ CTEST(misc, root_destroy)
     ASSERT_EQUAL(-1, root.res_len);
 }
 
+CTEST(misc, root_init_shared)
+{
+    sarg_opt args[] = {
+        {"n", "count", "some count variable", INT, NULL},
+        {"f", "file", "out file", STRING, NULL}
+    };
+    sarg_root root1, root2;
+    sarg_result *res;
+    const char *argv[3] = {"test", "-f", "foo"};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init_shared(&root1, args, 2, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init_shared(&root2, args, 2, "test"));
+
+    // both roots reference the same options, but own their results
+    ASSERT_EQUAL(SARG_ROOT_SHARED, root1.flags);
+    ASSERT_TRUE(root1.opts == args);
+    ASSERT_TRUE(root2.opts == args);
+    ASSERT_TRUE(root1.results != root2.results);
+    ASSERT_EQUAL(2, root1.res_len);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root1, argv, 3));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root1, "file", &res));
+    ASSERT_STR("foo", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root2, "file", &res));
+    ASSERT_EQUAL(0, res->count);
+
+    sarg_destroy(&root1);
+    ASSERT_NULL(root1.opts);
+    ASSERT_STR("out file", args[1].help);
+    sarg_destroy(&root2);
+}
+
+CTEST(misc, root_init_copy)
+{
+    const char *modes[] = {"fast", "safe", NULL};
+    const char *required[] = {"file", NULL};
+    sarg_opt args[] = {
+        {"n", "count", "some count variable", INT, NULL},
+        {"f", "file", "out file", STRING, NULL},
+        {"m", "mode", "mode", ENUM, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    const char *argv[5] = {"test", "-f", "foo", "-m", "safe"};
+    sarg_root src, copy;
+    sarg_result *res;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&src, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&src, "count", "7"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_choices(&src, "mode", modes));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&src, SARG_RULE_REQUIRED, required));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init_copy(&copy, &src));
+
+    // the tables are shared, the results are not
+    ASSERT_TRUE(copy.hashes == src.hashes);
+    ASSERT_TRUE(copy.choices == src.choices);
+    ASSERT_TRUE(copy.results != src.results);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&copy, "count", &res));
+    ASSERT_EQUAL(7, res->int_val);
+
+    ASSERT_EQUAL(SARG_ERR_MISSING, sarg_parse(&copy, argv, 1));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&copy, argv, 5));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&copy, "mode", &res));
+    ASSERT_EQUAL(1, res->int_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&src, "mode", &res));
+    ASSERT_EQUAL(0, res->count);
+
+    // the shared tables must not change
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_set_default(&copy, "count", "1"));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_add_rule(&copy, SARG_RULE_REQUIRED, required));
+
+    sarg_destroy(&copy);
+    ASSERT_TRUE(src.hashes != NULL);
+    sarg_destroy(&src);
+}
+
 CTEST(misc, result_init)
 {
     sarg_result res;
@@ -97,14 +175,33 @@ CTEST(misc, result_init)
 
 CTEST(misc, result_destroy)
 {
+    sarg_opt args[] = {{"s", NULL, NULL, STRING, NULL}, {NULL, NULL, NULL, INT, NULL}};
     sarg_result res;
+    sarg_root root;
+    size_t bytes;
 
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    bytes = sarg_memory_usage(&root).bytes;
     _sarg_result_init(&res, STRING);
-    res.str_val = (char *) malloc(8);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_str(&root, "value", &res));
     ASSERT_NOT_NULL(res.str_val);
+    ASSERT_TRUE(sarg_memory_usage(&root).bytes == bytes + 6);
 
-    _sarg_result_destroy(&res);
+    _sarg_result_destroy(&root, &res);
     ASSERT_NULL(res.str_val);
+    ASSERT_TRUE(sarg_memory_usage(&root).bytes == bytes);
+    sarg_destroy(&root);
+}
+
+CTEST(misc, strerror)
+{
+    ASSERT_STR("success", sarg_strerror(SARG_ERR_SUCCESS));
+    ASSERT_STR("unknown option", sarg_strerror(SARG_ERR_NOTFOUND));
+    ASSERT_STR("aborted by callback", sarg_strerror(SARG_ERR_ABORT));
+    ASSERT_STR("conflicting options", sarg_strerror(SARG_ERR_CONFLICT));
+    ASSERT_STR("value out of range", sarg_strerror(SARG_ERR_RANGE));
+    ASSERT_STR("unknown error", sarg_strerror(-100));
+    ASSERT_STR("unknown error", sarg_strerror(3));
 }
 
 CTEST(misc, get_number_base_dec)
@@ -328,7 +425,7 @@ CTEST2(parsing, parse_string_success)
 {
     data->result.type = STRING;
 
-    int ret = _sarg_parse_str("foobar", &data->result);
+    int ret = _sarg_parse_str(&data->root, "foobar", &data->result);
 
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
     ASSERT_STR("foobar", data->result.str_val);
@@ -362,6 +459,87 @@ CTEST2(parsing, find_arg_fail)
     ASSERT_EQUAL(-1, ret);
 }
 
+CTEST2(parsing, find_arg_index)
+{
+    ASSERT_NOT_NULL(data->root.names);
+    ASSERT_EQUAL(4, data->root.short_len);
+    ASSERT_EQUAL(4, data->root.long_len);
+
+    // short names are sorted
+    ASSERT_STR("f", data->root.names[0].name);
+    ASSERT_STR("q", data->root.names[3].name);
+    // followed by sorted long names
+    ASSERT_STR("count", data->root.names[4].name);
+    ASSERT_STR("quiet", data->root.names[7].name);
+}
+
+CTEST2(parsing, find_long_prefix)
+{
+    ASSERT_EQUAL(2, _sarg_find_long_prefix(&data->root, "pr", 2));
+    ASSERT_EQUAL(1, _sarg_find_long_prefix(&data->root, "count", 5));
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, _sarg_find_long_prefix(&data->root, "x", 1));
+}
+
+/* ==========================================================
+ * complete
+ * ========================================================== */
+
+CTEST2(parsing, complete_long)
+{
+    const sarg_opt *matches[4];
+
+    int ret = sarg_complete(&data->root, "--", matches, 4);
+    ASSERT_EQUAL(4, ret);
+    ASSERT_STR("count", matches[0]->long_name);
+    ASSERT_STR("file", matches[1]->long_name);
+    ASSERT_STR("prob", matches[2]->long_name);
+    ASSERT_STR("quiet", matches[3]->long_name);
+
+    ret = sarg_complete(&data->root, "--fi", matches, 4);
+    ASSERT_EQUAL(1, ret);
+    ASSERT_STR("file", matches[0]->long_name);
+
+    ret = sarg_complete(&data->root, "--xyz", matches, 4);
+    ASSERT_EQUAL(0, ret);
+}
+
+CTEST2(parsing, complete_short)
+{
+    const sarg_opt *matches[1];
+
+    // only as many matches as fit are written
+    int ret = sarg_complete(&data->root, "-", matches, 1);
+    ASSERT_EQUAL(4, ret);
+    ASSERT_STR("f", matches[0]->short_name);
+
+    ret = sarg_complete(&data->root, "-q", matches, 1);
+    ASSERT_EQUAL(1, ret);
+    ASSERT_STR("quiet", matches[0]->long_name);
+}
+
+CTEST(misc, complete_many)
+{
+    static char names[1000][8];
+    static sarg_opt opts[1001];
+    const sarg_opt *matches[16];
+    sarg_root root;
+    int i;
+
+    for(i = 0; i < 1000; ++i) {
+        sprintf(names[i], "opt%03d", i);
+        opts[i].long_name = names[i];
+        opts[i].type = INT;
+    }
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, opts, "test"));
+
+    ASSERT_EQUAL(10, sarg_complete(&root, "--opt12", matches, 16));
+    ASSERT_STR("opt120", matches[0]->long_name);
+    ASSERT_STR("opt129", matches[9]->long_name);
+    ASSERT_EQUAL(1000, sarg_complete(&root, "--op", matches, 16));
+
+    sarg_destroy(&root);
+}
+
 /* ==========================================================
  * get
  * ========================================================== */
@@ -380,6 +558,18 @@ CTEST2(parsing, get_success)
 
 }
 
+CTEST2(parsing, get_n)
+{
+    sarg_result *res;
+
+    // names do not need to be terminated and may keep their dashes
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get_n(&data->root, "--filename", 6, &res));
+    ASSERT_EQUAL(STRING, res->type);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get_n(&data->root, "qx", 1, &res));
+    ASSERT_EQUAL(BOOL, res->type);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, sarg_get_n(&data->root, "--", 2, &res));
+}
+
 CTEST2(parsing, get_fail)
 {
     sarg_result *res;
@@ -424,222 +614,2044 @@ CTEST2(parsing, parse_fail)
 
     int ret = sarg_parse(&data->root, (const char **) test_argv1, 7);
     ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(2, data->root.err_idx);
 
     ret = sarg_parse(&data->root, (const char **) test_argv2, 8);
     ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+    ASSERT_EQUAL(3, data->root.err_idx);
 }
 
-CTEST2(parsing, foreach)
+CTEST2(parsing, parse_fail_missing_value)
 {
-    sarg_iterator it;
-    int count;
-    char *test_argv[8] = {"myapp", "--prob", "0.1", "-f", "myfile", "--count", "10", "-q"};
+    char *test_argv[3] = {"myapp", "-q", "--count"};
 
-    int ret = sarg_parse(&data->root, (const char **) test_argv, 8);
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 3);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(2, data->root.err_idx);
 
-    count = 0;
-    sarg_foreach(&data->root, &it)
-    {
-        ++count;
-        if(!strcmp("i", it.name))
-        {
-            ASSERT_EQUAL(0,  it.result->count);
-        }
-        else if (!strcmp("n", it.name))
-        {
-            ASSERT_EQUAL(1,  it.result->count);
-            ASSERT_EQUAL(10,  it.result->int_val);
-        }
-        else if (!strcmp("prob", it.name))
-        {
-            ASSERT_EQUAL(1,  it.result->count);
-            ASSERT_DBL_NEAR(0.1,  it.result->double_val);
-        }
-        else if (!strcmp("f", it.name))
-        {
-            ASSERT_EQUAL(1, it.result->count);
-            ASSERT_STR("myfile",  it.result->str_val);
-        }
-        else if (!strcmp("q", it.name))
-        {
-            ASSERT_EQUAL(1,  it.result->count);
-            ASSERT_TRUE( it.result->bool_val);
-        }
-        else
-        {
-            // never reach this point
-            ASSERT_TRUE(0);
-        }
-    }
-    ASSERT_EQUAL(5, count);
+    ret = sarg_parse(&data->root, (const char **) test_argv, 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(-1, data->root.err_idx);
 }
 
-CTEST_TEARDOWN(parsing)
+CTEST2(parsing, positionals)
 {
-    _sarg_result_destroy(&data->result);
-    sarg_destroy(&data->root);
-}
-
-/* ==========================================================
- * Help Tests
- * ========================================================== */
+    char *test_argv[9] = {"myapp", "a.txt", "-f", "myfile", "b", "-q",
+                          "--", "-n", "@c"};
+    const int *pos;
+    sarg_result *res;
 
-#ifndef SARG_NO_PRINT
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 9);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
 
-CTEST_DATA(help)
-{
-    sarg_root root;
-    char *text;
-};
+    // option values are no positional arguments, nothing after -- is an option
+    ASSERT_EQUAL(4, sarg_positionals(&data->root, &pos));
+    ASSERT_EQUAL(1, pos[0]);
+    ASSERT_EQUAL(4, pos[1]);
+    ASSERT_EQUAL(7, pos[2]);
+    ASSERT_EQUAL(8, pos[3]);
 
-CTEST_SETUP(help)
-{
-    int ret;
-    sarg_opt args[] = {
-        {"n", "count", "some count variable", INT, NULL},
-        {NULL, "file", "out file", STRING, NULL},
-        {"q", NULL, "enable quiet mode", BOOL, NULL},
-        {NULL, NULL, NULL, INT, NULL}
-    };
+    ret = sarg_get(&data->root, "count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->count);
 
-    ret = sarg_init(&data->root, args, "test");
+#ifndef SARG_NO_FILE
+    // argument files do not touch the positional arguments of argv
+    ret = sarg_parse_file(&data->root, "test/test_args.txt");
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(4, sarg_positionals(&data->root, &pos));
+    ASSERT_EQUAL(8, pos[3]);
+#endif
 
-    data->text = NULL;
+    // a new parse starts over
+    ret = sarg_parse(&data->root, (const char **) test_argv, 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, sarg_positionals(&data->root, NULL));
+    sarg_reset(&data->root);
+    ASSERT_EQUAL(0, sarg_positionals(&data->root, NULL));
 }
 
-CTEST2(help, help_text)
+CTEST2(parsing, positionals_many)
 {
-    int ret;
-    char *exp_text = \
-                     "Usage: test [OPTION]... [ARG]...\n\n" \
-                     "  -n, --count INT             some count variable\n" \
-                     "  --file STRING               out file\n" \
-                     "  -q                          enable quiet mode\n";
-
-    ret = sarg_help_text(&data->root, &data->text);
-
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_STR(exp_text, data->text);
+    const char *test_argv[1001];
+    const int *pos;
+    int i;
+
+    test_argv[0] = "myapp";
+    for(i = 1; i < 1001; ++i)
+        test_argv[i] = i % 2 ? "file" : "--";
+
+    // only the first -- ends the options
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&data->root, test_argv, 1001));
+    ASSERT_EQUAL(999, sarg_positionals(&data->root, &pos));
+    ASSERT_EQUAL(1, pos[0]);
+    for(i = 1; i < 999; ++i)
+        ASSERT_EQUAL(i + 2, pos[i]);
 }
 
-CTEST_TEARDOWN(help)
+CTEST2(parsing, parse_attached_values)
 {
-    if(data->text)
-        free(data->text);
-    sarg_destroy(&data->root);
-}
+    char *test_argv[9] = {"myapp", "--count=10", "-i-3", "-qf", "my=file",
+                          "-", "--prob=0.5x", "--quiet=no", "--fi=a=b"};
+    const int *pos;
+    sarg_result *res;
 
-#endif
+    // values are attached with '=', to short names and to flag clusters
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 6);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(10, res->uint_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "i", &res));
+    ASSERT_EQUAL(-3, res->int_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "quiet", &res));
+    ASSERT_EQUAL(1, res->bool_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("my=file", res->str_val);
 
-/* ==========================================================
- * File Tests
- * ========================================================== */
+    // a single dash is positional, e.g. stdin
+    ASSERT_EQUAL(1, sarg_positionals(&data->root, &pos));
+    ASSERT_EQUAL(5, pos[0]);
 
-#ifndef SARG_NO_FILE
+    // the whole value has to be a number
+    ret = sarg_parse(&data->root, (const char **) test_argv, 7);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(6, data->root.err_idx);
 
-CTEST_DATA(file)
-{
-    sarg_root root;
-    char file1[32];
-    char file2[32];
-    char file3[32];
-};
+    // flags are set to a boolean word, abbreviations split at '=' too
+    // the first argument is skipped like a program name
+    sarg_reset(&data->root);
+    ret = sarg_parse(&data->root, (const char **) &test_argv[6], 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "quiet", &res));
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(0, res->bool_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("a=b", res->str_val);
 
-CTEST_SETUP(file)
-{
-    int ret;
-    sarg_opt args[] = {
-        {"n", "count", "some count variable", INT, NULL},
-        {NULL, "file", "out file", STRING, NULL},
-        {"q", NULL, "enable quiet mode", BOOL, NULL},
-        {NULL, NULL, NULL, INT, NULL}
-    };
+    ret = sarg_parse_string(&data->root, "-qn 7 --quiet=maybe");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(7, res->uint_val);
 
-    ret = sarg_init(&data->root, args, "test");
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    strcpy(data->file1, "test/test_args.txt");
-    strcpy(data->file2, "test/test_args_empty_lines.txt");
-    strcpy(data->file3, "test/test_args_untrimmed.txt");
+    // every character of a cluster has to be an option
+    ret = sarg_parse_string(&data->root, "-qx");
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
 }
 
-CTEST2(file, parse_success)
+CTEST2(parsing, parse_cmdline_success)
 {
-    int ret;
     sarg_result *res;
 
-    ret = sarg_parse_file(&data->root, data->file1);
+    int ret = sarg_parse_string(&data->root, "  --prob 0.1\t-f myfile --count 10 -q ");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(-1, data->root.err_idx);
+
+    ret = sarg_get(&data->root, "prob", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(0.1, res->double_val, 0.01);
 
+    ret = sarg_get(&data->root, "file", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
+    ASSERT_STR("myfile", res->str_val);
 
-    ret = sarg_get(&data->root, "n", &res);
+    ret = sarg_get(&data->root, "count", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
-    ASSERT_EQUAL(15, res->int_val);
+    ASSERT_EQUAL(10, res->uint_val);
 
     ret = sarg_get(&data->root, "q", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
     ASSERT_EQUAL(1, res->bool_val);
+}
 
-    ret = sarg_get(&data->root, "file", &res);
+CTEST2(parsing, parse_cmdline_n)
+{
+    const char *cmdline = "-f myfile --count 10";
+    sarg_result *res;
+
+    // the command line ends after the given length
+    int ret = sarg_parse_string_n(&data->root, cmdline, 17);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(10, data->root.err_idx);
+
+    ret = sarg_parse_string_n(&data->root, cmdline, 6);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(2, res->count);
-    ASSERT_STR("foo", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("myf", res->str_val);
 }
 
-CTEST2(file, parse_empty_lines)
+CTEST2(parsing, parse_cmdline_quotes)
 {
-    int ret;
     sarg_result *res;
+    int ret, i;
+    const char *cmdlines[][2] = {
+        {"-f 'my file'", "my file"},
+        {"-f \"my file\"", "my file"},
+        {"-f my\\ file", "my file"},
+        {"-f 'a \"b\" \\c'", "a \"b\" \\c"},
+        {"-f \"a 'b' \\\"c\\\" \\d \\$\"", "a 'b' \"c\" \\d $"},
+        {"-f pre'mid dle'\"post\"", "premid dlepost"},
+        {"-f line\\\ncontinued", "linecontinued"},
+        {"-f ''", ""},
+        {"'--file' x", "x"}
+    };
 
-    ret = sarg_parse_file(&data->root, data->file2);
+    for(i = 0; i < (int) (sizeof(cmdlines) / sizeof(cmdlines[0])); ++i) {
+        ret = sarg_parse_string(&data->root, cmdlines[i][0]);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+        ret = sarg_get(&data->root, "file", &res);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+        ASSERT_STR(cmdlines[i][1], res->str_val);
+    }
+}
 
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
+CTEST2(parsing, parse_cmdline_fail)
+{
+    int ret = sarg_parse_string(&data->root, "-q -f 'my file");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(6, data->root.err_idx);
 
-    ret = sarg_get(&data->root, "n", &res);
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
-    ASSERT_EQUAL(15, res->int_val);
+    ret = sarg_parse_string(&data->root, "-q -f my\\");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(6, data->root.err_idx);
 
-    ret = sarg_get(&data->root, "q", &res);
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
-    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_parse_string(&data->root, "-q \"--unknown\" x");
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+    ASSERT_EQUAL(3, data->root.err_idx);
 
-    ret = sarg_get(&data->root, "file", &res);
+    // last option is missing its value
+    ret = sarg_parse_string(&data->root, "-q --count");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(3, data->root.err_idx);
+
+    ret = sarg_parse_string(&data->root, "");
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(2, res->count);
-    ASSERT_STR("foo", res->str_val);
+    ASSERT_EQUAL(-1, data->root.err_idx);
 }
 
-CTEST2(file, parse_untrimmed)
+CTEST2(parsing, reset)
 {
-    int ret;
     sarg_result *res;
+    char *str;
+    char *test_argv1[5] = {"myapp", "-f", "myfile", "-q", "--count"};
+    char *test_argv2[3] = {"myapp", "-f", "other"};
 
-    ret = sarg_parse_file(&data->root, data->file3);
-
-    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
-
-    ret = sarg_get(&data->root, "n", &res);
+    int ret = sarg_parse(&data->root, (const char **) test_argv1, 5);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ret = sarg_get(&data->root, "file", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
-    ASSERT_EQUAL(15, res->int_val);
+    str = res->str_val;
 
+    sarg_reset(&data->root);
+    ASSERT_EQUAL(-1, data->root.err_idx);
+    ASSERT_EQUAL(0, res->count);
+    ASSERT_NULL(res->str_val);
     ret = sarg_get(&data->root, "q", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(1, res->count);
-    ASSERT_EQUAL(1, res->bool_val);
+    ASSERT_EQUAL(0, res->count);
+    ASSERT_EQUAL(0, res->bool_val);
 
+    // the memory of the previous string is reused
+    ret = sarg_parse(&data->root, (const char **) test_argv2, 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
     ret = sarg_get(&data->root, "file", &res);
     ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
-    ASSERT_EQUAL(2, res->count);
-    ASSERT_STR("foo", res->str_val);
+    ASSERT_STR("other", res->str_val);
+    ASSERT_TRUE(res->str_val == str);
+    ASSERT_EQUAL(1, res->count);
+}
+
+CTEST2(parsing, defaults)
+{
+    sarg_result *res;
+    char *test_argv[5] = {"myapp", "-f", "given", "-n", "3"};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&data->root, "file", "out.txt"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&data->root, "-n", "0x10"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&data->root, "quiet", "on"));
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_set_default(&data->root, "prob", "abc"));
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, sarg_set_default(&data->root, "foo", "1"));
+
+    // defaults are visible right away, but do not count as given
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("out.txt", res->str_val);
+    ASSERT_EQUAL(0, res->count);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(16, res->uint_val);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&data->root, (const char **) test_argv, 5));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("given", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(3, res->uint_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "quiet", &res));
+    ASSERT_EQUAL(1, res->bool_val);
+
+    sarg_reset(&data->root);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("out.txt", res->str_val);
+    ASSERT_EQUAL(0, res->count);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(16, res->uint_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "i", &res));
+    ASSERT_EQUAL(0, res->int_val);
+}
+
+CTEST2(parsing, rule_required)
+{
+    const char *required[] = {"file", "n", NULL};
+    const char *unknown[] = {"file", "foo", NULL};
+    char *test_argv[4] = {"myapp", "-f", "myfile", "-q"};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&data->root, SARG_RULE_REQUIRED, required));
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, sarg_add_rule(&data->root, SARG_RULE_REQUIRED, unknown));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_add_rule(&data->root, 7, required));
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_MISSING, ret);
+    ASSERT_EQUAL(1, data->root.err_opt);
+    ASSERT_EQUAL(-1, data->root.err_idx);
+
+    // results of several sources count together
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&data->root, "--count 2"));
+    ASSERT_EQUAL(-1, data->root.err_opt);
+
+    sarg_reset(&data->root);
+    ASSERT_EQUAL(SARG_ERR_MISSING, sarg_check(&data->root));
+    ASSERT_EQUAL(1, data->root.err_opt);
+}
+
+CTEST2(parsing, rule_exclusive)
+{
+    const char *exclusive[] = {"i", "prob", "quiet", NULL};
+    char *test_argv[6] = {"myapp", "-f", "myfile", "-q", "-i", "1"};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&data->root, SARG_RULE_EXCLUSIVE, exclusive));
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    sarg_reset(&data->root);
+    ret = sarg_parse(&data->root, (const char **) test_argv, 6);
+    ASSERT_EQUAL(SARG_ERR_CONFLICT, ret);
+    ASSERT_EQUAL(4, data->root.err_opt);
+}
+
+CTEST2(parsing, rule_depends)
+{
+    const char *depends[] = {"quiet", "file", "count", NULL};
+    char *test_argv[6] = {"myapp", "-q", "-f", "myfile", "-n", "1"};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&data->root, SARG_RULE_DEPENDS, depends));
+
+    // the rule only applies if its first option appeared
+    int ret = sarg_parse(&data->root, (const char **) &test_argv[1], 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    sarg_reset(&data->root);
+    ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_MISSING, ret);
+    ASSERT_EQUAL(1, data->root.err_opt);
+
+    sarg_reset(&data->root);
+    ret = sarg_parse(&data->root, (const char **) test_argv, 6);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+}
+
+CTEST2(parsing, layers)
+{
+    char *test_argv[5] = {"myapp", "-q", "-f", "argfile", "rest"};
+    sarg_result *res;
+    const int *pos;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&data->root, "count", "3"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_layer_parse_file(&data->root, SARG_LAYER_SYSTEM, "test/test_args.txt"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_layer_parse_string(&data->root, SARG_LAYER_ENV, "-n 20 -f envfile"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_layer_parse(&data->root, SARG_LAYER_ARGV, (const char **) test_argv, 5));
+
+    // the highest layer wins and BOOL options are not toggled twice
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("argfile", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(20, res->uint_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "quiet", &res));
+    ASSERT_EQUAL(1, res->bool_val);
+    ASSERT_EQUAL(1, sarg_positionals(&data->root, &pos));
+    ASSERT_EQUAL(4, pos[0]);
+
+    // replacing and dropping layers leaves the others alone
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_layer_parse_string(&data->root, SARG_LAYER_ENV, "--prob 0.5"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(15, res->uint_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_layer_clear(&data->root, SARG_LAYER_ARGV));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "file", &res));
+    ASSERT_STR("foo", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_layer_clear(&data->root, SARG_LAYER_SYSTEM));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "count", &res));
+    ASSERT_EQUAL(3, res->uint_val);
+    ASSERT_EQUAL(0, res->count);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "prob", &res));
+    ASSERT_DBL_NEAR_TOL(0.5, res->double_val, 0.01);
+
+    // a failed parse keeps the layer
+    ASSERT_EQUAL(SARG_ERR_PARSE,
+                 sarg_layer_parse_string(&data->root, SARG_LAYER_ENV, "--prob x"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&data->root, "prob", &res));
+    ASSERT_DBL_NEAR_TOL(0.5, res->double_val, 0.01);
+
+    ASSERT_EQUAL(SARG_ERR_INVALARG,
+                 sarg_layer_parse_string(&data->root, SARG_MAX_LAYERS, "-q"));
+}
+
+CTEST2(parsing, layers_rules)
+{
+    const char *required[] = {"file", NULL};
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&data->root, SARG_RULE_REQUIRED, required));
+
+    // rules apply to the effective results, not to single layers
+    ASSERT_EQUAL(SARG_ERR_MISSING,
+                 sarg_layer_parse_string(&data->root, SARG_LAYER_ENV, "-q"));
+    ASSERT_EQUAL(3, data->root.err_opt);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_layer_parse_string(&data->root, SARG_LAYER_USER, "-f x"));
+    ASSERT_EQUAL(SARG_ERR_MISSING, sarg_layer_clear(&data->root, SARG_LAYER_USER));
+}
+
+CTEST2(parsing, parse_abbrev)
+{
+    sarg_result *res;
+    char *test_argv[5] = {"myapp", "--pr", "0.1", "--qui", "--co"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_get(&data->root, "prob", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(0.1, res->double_val, 0.01);
+
+    ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_get(&data->root, "quiet", &res);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    // abbreviations only apply to parsing, not to sarg_get
+    ret = sarg_get(&data->root, "qui", &res);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+}
+
+CTEST(misc, rules_many)
+{
+    static char names[200][8];
+    sarg_opt args[201];
+    const char *exclusive[] = {names[3], names[130], names[199], NULL};
+    const char *required[] = {names[64], names[150], NULL};
+    const char *argv[4] = {"test", "--o64", "--o130", "--o150"};
+    sarg_root root;
+    int i;
+
+    for(i = 0; i < 200; ++i) {
+        snprintf(names[i], sizeof(names[i]), "o%d", i);
+        args[i].short_name = NULL;
+        args[i].long_name = names[i];
+        args[i].help = NULL;
+        args[i].type = BOOL;
+        args[i].callback = NULL;
+    }
+    memset(&args[200], 0, sizeof(sarg_opt));
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&root, SARG_RULE_EXCLUSIVE, exclusive));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&root, SARG_RULE_REQUIRED, required));
+
+    ASSERT_EQUAL(SARG_ERR_MISSING, sarg_parse(&root, argv, 2));
+    ASSERT_EQUAL(150, root.err_opt);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, &argv[1], 3));
+
+    // options in different words of the masks conflict as well
+    argv[3] = "--o199";
+    ASSERT_EQUAL(SARG_ERR_CONFLICT, sarg_parse(&root, &argv[1], 3));
+    ASSERT_EQUAL(199, root.err_opt);
+
+    sarg_destroy(&root);
+}
+
+CTEST(misc, enum_choices)
+{
+    sarg_opt args[] = {
+        {"m", "mode", "mode of operation", ENUM, NULL},
+        {"n", "count", NULL, INT, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    const char *modes[] = {"fast", "safe", "debug", NULL};
+    const char *dups[] = {"fast", "safe", "fast", NULL};
+    const char *argv[5] = {"test", "--mode", "debug", "-m", "safe"};
+    sarg_root root;
+    sarg_result *res;
+    char *text;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+
+    // without choices no value is accepted
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_parse(&root, argv, 3));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_set_choices(&root, "count", modes));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_set_choices(&root, "mode", dups));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_choices(&root, "mode", modes));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&root, "mode", "safe"));
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_set_default(&root, "mode", "slow"));
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "mode", &res));
+    ASSERT_EQUAL(1, res->int_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, 3));
+    ASSERT_EQUAL(2, res->int_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, 5));
+    ASSERT_EQUAL(1, res->int_val);
+
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_parse_string(&root, "-m fas"));
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_parse_string(&root, "-m fastest"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&root, "-m fast"));
+    ASSERT_EQUAL(0, res->int_val);
+
+#ifndef SARG_NO_PRINT
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_dump_text(&root, SARG_DUMP_JSON, 0, &text));
+    ASSERT_STR("{\"mode\":\"fast\"}", text);
+    sarg_free_text(&root, text);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_help_text(&root, &text));
+    ASSERT_STR("Usage: test [OPTION]... [ARG]...\n\n"
+               "  -m, --mode ENUM             mode of operation {fast|safe|debug}\n"
+               "  -n, --count INT             \n", text);
+    sarg_free_text(&root, text);
+#else
+    UNUSED(text);
+#endif
+
+    sarg_destroy(&root);
+}
+
+CTEST(misc, enum_many_choices)
+{
+    static char names[1000][8];
+    const char *choices[1001];
+    sarg_opt args[] = {
+        {"e", NULL, NULL, ENUM, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    sarg_root root;
+    sarg_result *res;
+    char cmdline[16];
+    int i;
+
+    for(i = 0; i < 1000; ++i) {
+        snprintf(names[i], sizeof(names[i]), "c%d", i);
+        choices[i] = names[i];
+    }
+    choices[1000] = NULL;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_choices(&root, "e", choices));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "e", &res));
+
+    for(i = 0; i < 1000; ++i) {
+        snprintf(cmdline, sizeof(cmdline), "-e c%d", i);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&root, cmdline));
+        ASSERT_EQUAL(i, res->int_val);
+    }
+    ASSERT_EQUAL(SARG_ERR_PARSE, sarg_parse_string(&root, "-e c1000"));
+
+    sarg_destroy(&root);
+}
+
+CTEST(misc, ranges)
+{
+    sarg_opt args[] = {
+        {"i", NULL, NULL, INT, NULL},
+        {"u", NULL, NULL, UINT, NULL},
+        {"d", NULL, NULL, DOUBLE, NULL},
+        {"s", NULL, NULL, STRING, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    sarg_root root;
+    sarg_result *res;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_range(&root, "i", -5, 5));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_range(&root, "u", 1, 0x10));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_range(&root, "d", 0.0, 1.0));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_set_range(&root, "s", 0, 1));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_set_range(&root, "i", 1, 0));
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_set_default(&root, "u", "0"));
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&root, "-i -5 -u 0x10 -d 1"));
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_parse_string(&root, "-i 6"));
+    ASSERT_EQUAL(3, root.err_idx);
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_parse_string(&root, "-u 17"));
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_parse_string(&root, "-d -0.1"));
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_parse_string(&root, "-d nan"));
+
+    // rejected values leave the previous one in place
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "i", &res));
+    ASSERT_EQUAL(-5, res->int_val);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "d", &res));
+    ASSERT_DBL_NEAR(1.0, res->double_val);
+
+    sarg_destroy(&root);
+}
+
+CTEST(misc, parse_size)
+{
+    sarg_result res;
+
+    _sarg_result_init(&res, SIZE);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("512", &res));
+    ASSERT_TRUE(res.size_val == 512);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("512B", &res));
+    ASSERT_TRUE(res.size_val == 512);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("512M", &res));
+    ASSERT_TRUE(res.size_val == 512000000ULL);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("4Gi", &res));
+    ASSERT_TRUE(res.size_val == 4ULL << 30);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("1.5KiB", &res));
+    ASSERT_TRUE(res.size_val == 1536);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("2k", &res));
+    ASSERT_TRUE(res.size_val == 2000);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("15Ei", &res));
+    ASSERT_TRUE(res.size_val == 15ULL << 60);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("18446744073709551615", &res));
+    ASSERT_TRUE(res.size_val == UINT64_MAX);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("0.001k", &res));
+    ASSERT_TRUE(res.size_val == 1);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("2.000", &res));
+    ASSERT_TRUE(res.size_val == 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("0.1M", &res));
+    ASSERT_TRUE(res.size_val == 100000);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("0.0009765625Ki", &res));
+    ASSERT_TRUE(res.size_val == 1);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_size("15.9375Ei", &res));
+    ASSERT_TRUE(res.size_val == 255ULL << 56);
+
+    ASSERT_EQUAL(SARG_ERR_RANGE, _sarg_parse_size("16Ei", &res));
+    ASSERT_EQUAL(SARG_ERR_RANGE, _sarg_parse_size("18446744073709551616", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("-1", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("M", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("1X", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("1Mx", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("1 M", &res));
+    // fractions of a byte
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("1.5", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("1.0001k", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_size("0.1Ki", &res));
+}
+
+CTEST(misc, parse_duration)
+{
+    sarg_result res;
+
+    _sarg_result_init(&res, DURATION);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_duration("0", &res));
+    ASSERT_TRUE(res.duration_val == 0);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_duration("250ms", &res));
+    ASSERT_TRUE(res.duration_val == 250000000ULL);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_duration("1.5s", &res));
+    ASSERT_TRUE(res.duration_val == 1500000000ULL);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_duration("1h30m", &res));
+    ASSERT_TRUE(res.duration_val == 5400000000000ULL);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, _sarg_parse_duration("2d3us7ns", &res));
+    ASSERT_TRUE(res.duration_val == 172800000003007ULL);
+
+    ASSERT_EQUAL(SARG_ERR_RANGE, _sarg_parse_duration("300000d", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_duration("", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_duration("5", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_duration("1h30", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_duration("1sec", &res));
+    ASSERT_EQUAL(SARG_ERR_PARSE, _sarg_parse_duration("s", &res));
+}
+
+CTEST(misc, size_duration_options)
+{
+    sarg_opt args[] = {
+        {"l", "limit", "memory limit", SIZE, NULL},
+        {"t", "timeout", NULL, DURATION, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    sarg_root root;
+    sarg_result *res;
+    char *text;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_range(&root, "limit", 0, 1 << 30));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_default(&root, "timeout", "1s"));
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&root, "--limit 1Gi -t 250ms"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "limit", &res));
+    ASSERT_TRUE(res->size_val == 1ULL << 30);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "timeout", &res));
+    ASSERT_TRUE(res->duration_val == 250000000ULL);
+    ASSERT_EQUAL(SARG_ERR_RANGE, sarg_parse_string(&root, "--limit 1.5Gi"));
+
+#ifndef SARG_NO_PRINT
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_dump_text(&root, SARG_DUMP_JSON, 0, &text));
+    ASSERT_STR("{\"limit\":1073741824,\"timeout\":\"250000000ns\"}", text);
+    sarg_free_text(&root, text);
+
+    // the dump reads back
+    sarg_reset(&root);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_json(&root, "{\"timeout\":\"5ns\"}", 17));
+    ASSERT_TRUE(res->duration_val == 5);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_help_text(&root, &text));
+    ASSERT_STR("Usage: test [OPTION]... [ARG]...\n\n"
+               "  -l, --limit SIZE            memory limit {B|k|M|G|T|P|E|Ki|Mi|Gi|Ti|Pi|Ei}\n"
+               "  -t, --timeout DURATION      {ns|us|ms|s|m|h|d}\n", text);
+    sarg_free_text(&root, text);
+#else
+    UNUSED(text);
+#endif
+
+    sarg_destroy(&root);
+}
+
+static int test_find(const char *name, const int len)
+{
+    // only the long names are known to this lookup
+    if(len == 5 && memcmp(name, "count", 5) == 0)
+        return 0;
+    if(len == 4 && memcmp(name, "name", 4) == 0)
+        return 1;
+    return -1;
+}
+
+CTEST(misc, set_lookup)
+{
+    sarg_opt args[] = {
+        {"c", "count", NULL, INT, NULL},
+        {"n", "name", NULL, STRING, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    const char *argv[] = {"test", "--count", "3", "--name", "x"};
+    sarg_root root;
+    sarg_result *res;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    sarg_set_lookup(&root, test_find);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv, 5));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "count", &res));
+    ASSERT_EQUAL(3, res->int_val);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "name", &res));
+    ASSERT_STR("x", res->str_val);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, sarg_get(&root, "c", &res));
+
+    // back to the built in lookup
+    sarg_set_lookup(&root, NULL);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "c", &res));
+    ASSERT_EQUAL(3, res->int_val);
+
+    sarg_destroy(&root);
+}
+
+CTEST(misc, parse_abbrev_ambiguous)
+{
+    sarg_opt args[] = {
+        {NULL, "verbose", NULL, BOOL, NULL},
+        {NULL, "version", NULL, BOOL, NULL},
+        {NULL, "ver", NULL, BOOL, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    const char *argv1[2] = {"test", "--ve"};
+    const char *argv2[2] = {"test", "--ver"};
+    const char *argv3[2] = {"test", "--"};
+    sarg_root root;
+    sarg_result *res;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_AMBIGUOUS, sarg_parse(&root, argv1, 2));
+    ASSERT_EQUAL(1, root.err_idx);
+
+    // exact matches win over abbreviations
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv2, 2));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&root, "ver", &res));
+    ASSERT_EQUAL(1, res->count);
+
+    // "--" ends the options everywhere
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse(&root, argv3, 2));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_string(&root, "-- --unknown"));
+    ASSERT_EQUAL(SARG_ERR_AMBIGUOUS, sarg_parse_string(&root, "--ve=yes"));
+
+    sarg_destroy(&root);
+}
+
+CTEST2(parsing, foreach)
+{
+    sarg_iterator it;
+    int count;
+    char *test_argv[8] = {"myapp", "--prob", "0.1", "-f", "myfile", "--count", "10", "-q"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 8);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    count = 0;
+    sarg_foreach(&data->root, &it)
+    {
+        ++count;
+        if(!strcmp("i", it.name))
+        {
+            ASSERT_EQUAL(0,  it.result->count);
+        }
+        else if (!strcmp("n", it.name))
+        {
+            ASSERT_EQUAL(1,  it.result->count);
+            ASSERT_EQUAL(10,  it.result->int_val);
+        }
+        else if (!strcmp("prob", it.name))
+        {
+            ASSERT_EQUAL(1,  it.result->count);
+            ASSERT_DBL_NEAR(0.1,  it.result->double_val);
+        }
+        else if (!strcmp("f", it.name))
+        {
+            ASSERT_EQUAL(1, it.result->count);
+            ASSERT_STR("myfile",  it.result->str_val);
+        }
+        else if (!strcmp("q", it.name))
+        {
+            ASSERT_EQUAL(1,  it.result->count);
+            ASSERT_TRUE( it.result->bool_val);
+        }
+        else
+        {
+            // never reach this point
+            ASSERT_TRUE(0);
+        }
+    }
+    ASSERT_EQUAL(5, count);
+}
+
+CTEST_TEARDOWN(parsing)
+{
+    _sarg_result_destroy(&data->root, &data->result);
+    sarg_destroy(&data->root);
+}
+
+/* ==========================================================
+ * Command Tests
+ * ========================================================== */
+
+sarg_opt test_cmd_add_args[] = {
+    {"n", "dry-run", "only show what would be done", BOOL, NULL},
+    {"m", "message", "message to add", STRING, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+sarg_opt test_cmd_log_args[] = {
+    {"n", "max-count", "limit number of entries", INT, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+sarg_cmd test_cmds[] = {
+    {"add", "add files", test_cmd_add_args},
+    {"log", "show log", test_cmd_log_args},
+    {"status", "show status", NULL},
+    {NULL, NULL, NULL}
+};
+
+CTEST_DATA(command)
+{
+    sarg_root root;
+};
+
+CTEST_SETUP(command)
+{
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&data->root, test_args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_set_commands(&data->root, test_cmds));
+}
+
+CTEST2(command, lazy_init)
+{
+    ASSERT_EQUAL(3, data->root.cmd_len);
+    ASSERT_NULL(data->root.cmd_root);
+    ASSERT_NULL(sarg_command(&data->root));
+}
+
+CTEST2(command, parse_success)
+{
+    sarg_result *res;
+    sarg_root *cmd_root;
+    char *test_argv[7] = {"myapp", "-q", "--count", "3", "log", "-n", "5"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 7);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("log", sarg_command(&data->root));
+
+    // options before the command belong to the root
+    ret = sarg_get(&data->root, "n", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(3, res->uint_val);
+    ret = sarg_get(&data->root, "q", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    cmd_root = sarg_command_root(&data->root);
+    ASSERT_NOT_NULL(cmd_root);
+    ASSERT_EQUAL(1, cmd_root->opt_len);
+    ret = sarg_get(cmd_root, "max-count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(5, res->int_val);
+}
+
+CTEST2(command, parse_no_options)
+{
+    char *test_argv[2] = {"myapp", "status"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("status", sarg_command(&data->root));
+    ASSERT_EQUAL(0, sarg_command_root(&data->root)->opt_len);
+}
+
+CTEST2(command, parse_fail)
+{
+    char *test_argv1[3] = {"myapp", "-q", "commit"};
+    char *test_argv2[5] = {"myapp", "-q", "add", "-m", "--unknown"};
+    char *test_argv3[6] = {"myapp", "-q", "add", "-m", "msg", "--unknown"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv1, 3);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+    ASSERT_EQUAL(2, data->root.err_idx);
+
+    ret = sarg_parse(&data->root, (const char **) test_argv2, 5);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_parse(&data->root, (const char **) test_argv3, 6);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+    ASSERT_EQUAL(5, data->root.err_idx);
+}
+
+CTEST2(command, reset)
+{
+    sarg_root *cmd_root;
+    sarg_result *res;
+    char *test_argv[4] = {"myapp", "log", "-n", "5"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    cmd_root = sarg_command_root(&data->root);
+
+    sarg_reset(&data->root);
+    ASSERT_NULL(sarg_command(&data->root));
+    ASSERT_NULL(sarg_command_root(&data->root));
+
+    // the subcommand root is kept and reused
+    ret = sarg_parse(&data->root, (const char **) test_argv, 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("log", sarg_command(&data->root));
+    ASSERT_TRUE(cmd_root == sarg_command_root(&data->root));
+    ret = sarg_get(cmd_root, "max-count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->count);
+}
+
+CTEST2(command, parse_cmdline)
+{
+    sarg_result *res;
+
+    int ret = sarg_parse_string(&data->root, "-q add -m 'first commit'");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("add", sarg_command(&data->root));
+    ret = sarg_get(sarg_command_root(&data->root), "message", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("first commit", res->str_val);
+
+    ret = sarg_parse_string(&data->root, "\"log\" -n 3 --unknown");
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+    ASSERT_EQUAL(11, data->root.err_idx);
+}
+
+#ifndef SARG_NO_PRINT
+
+CTEST2(command, help_text)
+{
+    char *text;
+    char *exp_text = \
+                     "Usage: test [OPTION]... COMMAND [ARG]...\n\n" \
+                     "  -i INT                      foo bar\n" \
+                     "  -n, --count UINT            some count variable\n" \
+                     "  --prob DOUBLE               probability\n" \
+                     "  -f, --file STRING           out file\n" \
+                     "  -q, --quiet                 enable quiet mode\n" \
+                     "\nCommands:\n" \
+                     "  add                         add files\n" \
+                     "  log                         show log\n" \
+                     "  status                      show status\n";
+
+    int ret = sarg_help_text(&data->root, &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR(exp_text, text);
+    sarg_free_text(&data->root, text);
+}
+
+CTEST2(command, help_text_command)
+{
+    char *text;
+    char *exp_text = \
+                     "Usage: test add [OPTION]... [ARG]...\n\n" \
+                     "  -n, --dry-run               only show what would be done\n" \
+                     "  -m, --message STRING        message to add\n";
+
+    int ret = sarg_command_help_text(&data->root, "add", &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR(exp_text, text);
+    sarg_free_text(&data->root, text);
+    // help text does not select a command
+    ASSERT_NULL(sarg_command(&data->root));
+
+    ret = sarg_command_help_text(&data->root, "commit", &text);
+    ASSERT_EQUAL(SARG_ERR_NOTFOUND, ret);
+}
+
+#endif
+
+CTEST_TEARDOWN(command)
+{
+    sarg_destroy(&data->root);
+}
+
+typedef struct _test_heap {
+    long calls;
+    // number of the call that fails, 0 for none
+    long fail_at;
+} test_heap;
+
+static void *test_heap_malloc(void *ctx, size_t size)
+{
+    test_heap *heap = (test_heap *) ctx;
+
+    if(++heap->calls == heap->fail_at)
+        return NULL;
+    return malloc(size);
+}
+
+static void *test_heap_realloc(void *ctx, void *ptr, size_t size)
+{
+    test_heap *heap = (test_heap *) ctx;
+
+    if(++heap->calls == heap->fail_at)
+        return NULL;
+    return realloc(ptr, size);
+}
+
+static void test_heap_free(void *ctx, void *ptr)
+{
+    UNUSED(ctx);
+    free(ptr);
+}
+
+/* parses a subcommand, strings and a layer with the given heap */
+static int test_heap_parse(test_heap *heap, sarg_root *root)
+{
+    sarg_allocator alloc = {test_heap_malloc, test_heap_realloc, test_heap_free, heap};
+    const char *argv[] = {"test", "-f", "a file", "log", "-n", "5", "x"};
+    int ret;
+
+    ret = sarg_init_alloc(root, test_args, "test", &alloc);
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+
+    ret = sarg_set_commands(root, test_cmds);
+    if(ret == SARG_ERR_SUCCESS)
+        ret = sarg_set_default(root, "file", "default");
+    if(ret == SARG_ERR_SUCCESS)
+        ret = sarg_layer_parse_string(root, SARG_LAYER_ENV, "-q");
+    if(ret == SARG_ERR_SUCCESS)
+        ret = sarg_parse(root, argv, 7);
+
+    return ret;
+}
+
+CTEST(misc, allocator)
+{
+    test_heap heap = {0, 0};
+    sarg_memory mem;
+    sarg_root root;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, test_heap_parse(&heap, &root));
+    ASSERT_NOT_NULL(sarg_command_root(&root));
+
+    // the subcommand root allocates from the heap of its parent
+    mem = sarg_memory_usage(&root);
+    ASSERT_TRUE(mem.allocs > 0);
+    ASSERT_TRUE(mem.bytes > 0);
+    ASSERT_EQUAL(heap.calls, (long) mem.total);
+
+    sarg_destroy(&root);
+    ASSERT_TRUE(root.mem.bytes == 0);
+    ASSERT_TRUE(root.mem.allocs == 0);
+}
+
+CTEST(misc, allocator_default)
+{
+    test_heap heap = {0, 0};
+    sarg_allocator alloc = {test_heap_malloc, test_heap_realloc, test_heap_free, &heap};
+    sarg_root root;
+
+    sarg_set_allocator(&alloc);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, test_args, "test"));
+    sarg_set_allocator(NULL);
+    ASSERT_TRUE(heap.calls > 0);
+    ASSERT_EQUAL(heap.calls, (long) sarg_memory_usage(&root).total);
+    sarg_destroy(&root);
+
+    // the default is only used without an allocator of its own
+    heap.calls = 0;
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, test_args, "test"));
+    ASSERT_EQUAL(0, heap.calls);
+    sarg_destroy(&root);
+}
+
+#ifndef SARG_NO_PRINT
+
+CTEST(misc, allocator_text)
+{
+    test_heap heap = {0, 0};
+    sarg_memory before, mem;
+    sarg_root root;
+    char *help, *cmd_help, *dump;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, test_heap_parse(&heap, &root));
+    before = sarg_memory_usage(&root);
+
+    // texts for the caller come from the heap of the root, including
+    // the help text of a temporarily initialized subcommand
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_help_text(&root, &help));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_command_help_text(&root, "add", &cmd_help));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_dump_text(&root, SARG_DUMP_JSON, 0, &dump));
+    mem = sarg_memory_usage(&root);
+    ASSERT_TRUE(mem.allocs == before.allocs + 3);
+    ASSERT_TRUE(mem.bytes > before.bytes);
+
+    sarg_free_text(&root, help);
+    sarg_free_text(&root, cmd_help);
+    sarg_free_text(&root, dump);
+    sarg_free_text(&root, NULL);
+    mem = sarg_memory_usage(&root);
+    ASSERT_TRUE(mem.allocs == before.allocs);
+    ASSERT_TRUE(mem.bytes == before.bytes);
+
+    sarg_destroy(&root);
+}
+
+#endif
+
+CTEST(misc, allocator_failure)
+{
+    test_heap heap = {0, 0};
+    sarg_root root;
+    long i, calls;
+    int ret;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, test_heap_parse(&heap, &root));
+    sarg_destroy(&root);
+    calls = heap.calls;
+
+    // every failing allocation is reported and nothing leaks
+    for(i = 1; i <= calls; ++i) {
+        heap.calls = 0;
+        heap.fail_at = i;
+        ret = test_heap_parse(&heap, &root);
+        ASSERT_EQUAL(SARG_ERR_ALLOC, ret);
+        if(root.opts)
+            sarg_destroy(&root);
+        ASSERT_TRUE(root.mem.allocs == 0);
+    }
+}
+
+/* ==========================================================
+ * Static Tests
+ * ========================================================== */
+
+CTEST_DATA(static_root)
+{
+    sarg_root root;
+    sarg_result results[5];
+    char str_buf[16];
+    sarg_storage storage;
+};
+
+CTEST_SETUP(static_root)
+{
+    data->storage.results = data->results;
+    data->storage.res_len = 5;
+    data->storage.str_buf = data->str_buf;
+    data->storage.str_len = 16;
+    data->storage.help_buf = NULL;
+    data->storage.help_len = 0;
+    data->storage.pos_buf = NULL;
+    data->storage.pos_len = 0;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_init_static(&data->root, test_args, "test", &data->storage));
+}
+
+CTEST2(static_root, init)
+{
+    ASSERT_EQUAL(SARG_ROOT_STATIC, data->root.flags);
+    ASSERT_EQUAL(5, data->root.opt_len);
+    ASSERT_EQUAL(5, data->root.res_len);
+    // options are referenced, not copied
+    ASSERT_TRUE(data->root.opts == test_args);
+    ASSERT_TRUE(data->root.results == data->results);
+    ASSERT_EQUAL(STRING, data->results[3].type);
+}
+
+CTEST2(static_root, init_too_small)
+{
+    sarg_root root;
+
+    data->storage.res_len = 4;
+    ASSERT_EQUAL(SARG_ERR_ALLOC,
+                 sarg_init_static(&root, test_args, "test", &data->storage));
+}
+
+CTEST2(static_root, parse_success)
+{
+    sarg_result *res;
+    char *test_argv[6] = {"myapp", "-f", "myfile", "--count", "10", "-q"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 6);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("myfile", res->str_val);
+    ASSERT_TRUE(res->str_val == data->str_buf);
+
+    ret = sarg_get(&data->root, "count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(10, res->uint_val);
+}
+
+
+CTEST2(static_root, positionals)
+{
+    char *test_argv[5] = {"myapp", "a", "-q", "b", "c"};
+    int pos_buf[2];
+    const int *pos;
+
+    // without buffer positional arguments are skipped
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 5);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, sarg_positionals(&data->root, &pos));
+
+    data->storage.pos_buf = pos_buf;
+    data->storage.pos_len = 2;
+    ASSERT_EQUAL(SARG_ERR_SUCCESS,
+                 sarg_init_static(&data->root, test_args, "test", &data->storage));
+    ret = sarg_parse(&data->root, (const char **) test_argv, 4);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, sarg_positionals(&data->root, &pos));
+    ASSERT_TRUE(pos == pos_buf);
+    ASSERT_EQUAL(3, pos[1]);
+
+    ret = sarg_parse(&data->root, (const char **) test_argv, 5);
+    ASSERT_EQUAL(SARG_ERR_ALLOC, ret);
+    ASSERT_EQUAL(4, data->root.err_idx);
+}
+
+CTEST2(static_root, parse_str_reuse)
+{
+    sarg_result *res;
+    char *test_argv[5] = {"myapp", "-f", "myfile", "-f", "other"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 5);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    // shorter value is stored in place
+    ASSERT_EQUAL(7, data->root.str_off);
+
+    ret = sarg_get(&data->root, "f", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("other", res->str_val);
+}
+
+CTEST2(static_root, parse_str_exhausted)
+{
+    char *test_argv[5] = {"myapp", "-f", "myfile", "-f", "my_very_long_file"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv, 5);
+    ASSERT_EQUAL(SARG_ERR_ALLOC, ret);
+}
+
+CTEST2(static_root, parse_cmdline)
+{
+    sarg_result *res;
+
+    int ret = sarg_parse_string(&data->root, "-f 'my file' -q");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_get(&data->root, "f", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("my file", res->str_val);
+    ASSERT_EQUAL(8, data->root.str_off);
+
+    // quoted arguments have to fit into the rest of the buffer
+    ret = sarg_parse_string(&data->root, "-f 'my very long file'");
+    ASSERT_EQUAL(SARG_ERR_ALLOC, ret);
+}
+
+CTEST2(static_root, reset)
+{
+    char *test_argv1[3] = {"myapp", "-f", "short"};
+    char *test_argv2[3] = {"myapp", "-f", "my_long_file"};
+
+    int ret = sarg_parse(&data->root, (const char **) test_argv1, 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    // without a reset the longer value would not fit anymore
+    sarg_reset(&data->root);
+    ASSERT_EQUAL(0, data->root.str_off);
+    ASSERT_NULL(data->results[3].str_val);
+    ret = sarg_parse(&data->root, (const char **) test_argv2, 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_TRUE(data->results[3].str_val == data->str_buf);
+}
+
+CTEST_TEARDOWN(static_root)
+{
+    sarg_destroy(&data->root);
+}
+
+/* ==========================================================
+ * Help Tests
+ * ========================================================== */
+
+#ifndef SARG_NO_PRINT
+
+CTEST_DATA(help)
+{
+    sarg_root root;
+    char *text;
+};
+
+CTEST_SETUP(help)
+{
+    int ret;
+    sarg_opt args[] = {
+        {"n", "count", "some count variable", INT, NULL},
+        {NULL, "file", "out file", STRING, NULL},
+        {"q", NULL, "enable quiet mode", BOOL, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+
+    ret = sarg_init(&data->root, args, "test");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    data->text = NULL;
+}
+
+CTEST2(help, help_text)
+{
+    int ret;
+    char *exp_text = \
+                     "Usage: test [OPTION]... [ARG]...\n\n" \
+                     "  -n, --count INT             some count variable\n" \
+                     "  --file STRING               out file\n" \
+                     "  -q                          enable quiet mode\n";
+
+    ret = sarg_help_text(&data->root, &data->text);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR(exp_text, data->text);
+}
+
+CTEST_TEARDOWN(help)
+{
+    if(data->text)
+        sarg_free_text(&data->root, data->text);
+    sarg_destroy(&data->root);
+}
+
+#endif
+
+/* ==========================================================
+ * INI Tests
+ * ========================================================== */
+
+sarg_opt test_config_args[] = {
+    {"v", "verbose", "verbose output", BOOL, NULL},
+    {NULL, "name", "name of the app", STRING, NULL},
+    {NULL, "server.host", "host name", STRING, NULL},
+    {NULL, "server.port", "port number", UINT, NULL},
+    {NULL, "server.debug", "debug mode", BOOL, NULL},
+    {NULL, "limits.ratio", "some ratio", DOUBLE, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+CTEST_DATA(ini)
+{
+    sarg_root root;
+};
+
+CTEST_SETUP(ini)
+{
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&data->root, test_config_args, "test"));
+}
+
+CTEST2(ini, parse_success)
+{
+    sarg_result *res;
+    const char *text =
+        "; comment\r\n"
+        "verbose = yes\n"
+        "\n"
+        "[server]\n"
+        "  host=localhost # comment\n"
+        "port = 0x50\n"
+        "debug\n"
+        "[]\n"
+        "name = ' spaced # name '\n";
+
+    int ret = sarg_parse_ini(&data->root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(-1, data->root.err_idx);
+
+    ret = sarg_get(&data->root, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_get(&data->root, "server.host", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("localhost", res->str_val);
+    ret = sarg_get(&data->root, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(80, res->uint_val);
+    ret = sarg_get(&data->root, "server.debug", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_get(&data->root, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR(" spaced # name ", res->str_val);
+}
+
+CTEST2(ini, parse_bool)
+{
+    sarg_result *res;
+    const char *text = "verbose = on\nverbose = on\n[server]\ndebug = false\n";
+
+    // BOOL values are set, not toggled
+    int ret = sarg_parse_ini(&data->root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_get(&data->root, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ASSERT_EQUAL(2, res->count);
+    ret = sarg_get(&data->root, "server.debug", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->bool_val);
+    ASSERT_EQUAL(1, res->count);
+}
+
+CTEST2(ini, parse_fail)
+{
+    int i, ret;
+    const char *texts[][2] = {
+        {"verbose\n[server\nport = 1\n", "2"},
+        {"\n\nport = 1\n", "3"},
+        {"[server]\nport\n", "2"},
+        {"[server]\nport = abc\n", "2"},
+        {"[server]\nhost = 'unterminated\n", "2"},
+        {"[server]\nhost = 'a' b\n", "2"},
+        {"verbose = maybe\n", "1"},
+        {" = 1\n", "1"}
+    };
+    const int errs[] = {
+        SARG_ERR_PARSE, SARG_ERR_NOTFOUND, SARG_ERR_PARSE, SARG_ERR_PARSE,
+        SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE
+    };
+
+    for(i = 0; i < (int) (sizeof(errs) / sizeof(errs[0])); ++i) {
+        ret = sarg_parse_ini(&data->root, texts[i][0], strlen(texts[i][0]));
+        ASSERT_EQUAL(errs[i], ret);
+        ASSERT_EQUAL(atoi(texts[i][1]), data->root.err_idx);
+    }
+}
+
+#ifndef SARG_NO_FILE
+
+CTEST2(ini, parse_file)
+{
+    sarg_result *res;
+
+    int ret = sarg_parse_ini_file(&data->root, "test/test_config.ini");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("my app", res->str_val);
+    ret = sarg_get(&data->root, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_get(&data->root, "server.host", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("example.org", res->str_val);
+    ret = sarg_get(&data->root, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(8080, res->uint_val);
+    ret = sarg_get(&data->root, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(0.75, res->double_val, 0.001);
+
+    ret = sarg_parse_ini_file(&data->root, "test/does_not_exist.ini");
+    ASSERT_EQUAL(SARG_ERR_ERRNO, ret);
+}
+
+#endif
+
+CTEST_TEARDOWN(ini)
+{
+    sarg_destroy(&data->root);
+}
+
+/* ==========================================================
+ * JSON Tests
+ * ========================================================== */
+
+CTEST_DATA(json)
+{
+    sarg_root root;
+};
+
+CTEST_SETUP(json)
+{
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&data->root, test_config_args, "test"));
+}
+
+CTEST2(json, parse_success)
+{
+    sarg_result *res;
+    const char *text =
+        "{\"verbose\": true, \"name\": \"a \\\"b\\\"\\t\\u00e9\\ud83d\\ude00\",\n"
+        " \"server\": {\"host\": \"localhost\", \"port\": 8080, \"debug\": false,\n"
+        "             \"ignored\": null},\n"
+        " \"limits\": {\"ratio\": -2.5e-1}, \"server.port\": 80}";
+
+    int ret = sarg_parse_json(&data->root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(-1, data->root.err_idx);
+
+    ret = sarg_get(&data->root, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_get(&data->root, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("a \"b\"\t\xc3\xa9\xf0\x9f\x98\x80", res->str_val);
+    ret = sarg_get(&data->root, "server.host", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("localhost", res->str_val);
+    ret = sarg_get(&data->root, "server.debug", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->bool_val);
+    ASSERT_EQUAL(1, res->count);
+    ret = sarg_get(&data->root, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(-0.25, res->double_val, 0.001);
+
+    // dotted keys and nested objects name the same option
+    ret = sarg_get(&data->root, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(80, res->uint_val);
+    ASSERT_EQUAL(2, res->count);
+}
+
+CTEST2(json, parse_literals)
+{
+    sarg_result *res;
+    const char *text = "{\"server\": {\"port\": 0}, \"limits\": {\"ratio\": 1.5E+2},"
+                       " \"verbose\": false, \"name\": null}";
+
+    int ret = sarg_parse_json(&data->root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->uint_val);
+    ret = sarg_get(&data->root, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(150.0, res->double_val, 0.001);
+    ret = sarg_get(&data->root, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->count);
+}
+
+CTEST2(json, parse_array)
+{
+    sarg_result *res;
+    const char *text = "{\"server\": {\"host\": [\"a\", \"b\", \"c\"]}, \"verbose\": []}";
+
+    int ret = sarg_parse_json(&data->root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "server.host", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("c", res->str_val);
+    ASSERT_EQUAL(3, res->count);
+    ret = sarg_get(&data->root, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(0, res->count);
+}
+
+static char test_json_seen[4][8];
+static int test_json_seen_len;
+
+static int test_json_record(const sarg_result *res)
+{
+    if(test_json_seen_len < 4)
+        snprintf(test_json_seen[test_json_seen_len++], 8, "%u", res->uint_val);
+    return 0;
+}
+
+CTEST(json, parse_array_callback)
+{
+    sarg_root root;
+    sarg_result *res;
+    sarg_opt args[] = {
+        {"p", "port", "port number", UINT, test_json_record},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    const char *text = "{\"port\": [80, 443, 8080]}";
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    test_json_seen_len = 0;
+
+    // elements behave like "-p 80 -p 443 -p 8080"
+    int ret = sarg_parse_json(&root, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(3, test_json_seen_len);
+    ASSERT_STR("80", test_json_seen[0]);
+    ASSERT_STR("443", test_json_seen[1]);
+    ASSERT_STR("8080", test_json_seen[2]);
+
+    ret = sarg_get(&root, "port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(8080, res->uint_val);
+    ASSERT_EQUAL(3, res->count);
+
+    sarg_destroy(&root);
+}
+
+CTEST2(json, parse_fail)
+{
+    int i, ret;
+    const char *texts[] = {
+        "[1]",
+        "{\"name\": \"x\"} {}",
+        "{\"name\" \"x\"}",
+        "{\"name\": \"x\",}",
+        "{\"unknown\": 1}",
+        "{\"server\": {\"port\": abc}}",
+        "{\"name\": \"x\\q\"}",
+        "{\"name\": \"x\\ud83d\"}",
+        "{\"name\": [{\"a\": 1}]}",
+        "{\"name\": \"unterminated}",
+        "{\"name\": foo}",
+        "{\"server\": {\"port\": 08}}",
+        "{\"limits\": {\"ratio\": 1.}}",
+        "{\"verbose\": truex}",
+        "{\"server\": {\"host\": [\"a\", [\"b\"]]}}",
+        "{\"verbose\": [true,]}",
+        "{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{"
+        "\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{"
+        "\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{\"a\":{}}"
+    };
+    const int errs[] = {
+        SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE,
+        SARG_ERR_NOTFOUND, SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE,
+        SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE,
+        SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE, SARG_ERR_PARSE,
+        SARG_ERR_RECURSION
+    };
+    const int offsets[] = {
+        0, 14, 8, 13, 12, 20, 13, 17, 10, 23, 9, 20, 21, 12, 26, 18, 160
+    };
+
+    for(i = 0; i < (int) (sizeof(errs) / sizeof(errs[0])); ++i) {
+        ret = sarg_parse_json(&data->root, texts[i], strlen(texts[i]));
+        ASSERT_EQUAL(errs[i], ret);
+        ASSERT_EQUAL(offsets[i], data->root.err_idx);
+    }
+}
+
+#ifndef SARG_NO_FILE
+
+CTEST2(json, parse_file)
+{
+    sarg_result *res;
+
+    int ret = sarg_parse_json_file(&data->root, "test/test_config.json");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("my app", res->str_val);
+    ret = sarg_get(&data->root, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(8080, res->uint_val);
+    ret = sarg_get(&data->root, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_DBL_NEAR_TOL(0.75, res->double_val, 0.001);
+}
+
+#endif
+
+CTEST_TEARDOWN(json)
+{
+    sarg_destroy(&data->root);
+}
+
+#ifndef SARG_NO_PRINT
+
+/* ==========================================================
+ * Dump Tests
+ * ========================================================== */
+
+CTEST_DATA(dump)
+{
+    sarg_root root;
+    sarg_root copy;
+};
+
+CTEST_SETUP(dump)
+{
+    const char *text =
+        "verbose\nname = 'my \"app\" \\'\n"
+        "[server]\nport = 8080\ndebug = no\n"
+        "[limits]\nratio = 0.1\n";
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&data->root, test_config_args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&data->copy, test_config_args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_ini(&data->root, text, strlen(text)));
+}
+
+CTEST2(dump, json)
+{
+    sarg_result *res;
+    char *text;
+
+    int ret = sarg_dump_text(&data->root, SARG_DUMP_JSON, 0, &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("{\"verbose\":true,\"name\":\"my \\\"app\\\" \\\\\","
+               "\"server.port\":8080,\"server.debug\":false,"
+               "\"limits.ratio\":0.1}", text);
+
+    // the dump reads back into the same results
+    ret = sarg_parse_json(&data->copy, text, strlen(text));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    sarg_free_text(&data->root, text);
+
+    ret = sarg_get(&data->copy, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("my \"app\" \\", res->str_val);
+    ret = sarg_get(&data->copy, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_TRUE(res->double_val == 0.1);
+}
+
+CTEST2(dump, json_all)
+{
+    sarg_result *res;
+    char *text;
+    int ret;
+
+    sarg_get(&data->root, "limits.ratio", &res);
+    res->double_val = 1.0 / 3.0;
+
+    ret = sarg_dump_text(&data->root, SARG_DUMP_JSON, SARG_DUMP_ALL, &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("{\"verbose\":true,\"name\":\"my \\\"app\\\" \\\\\","
+               "\"server.host\":null,\"server.port\":8080,"
+               "\"server.debug\":false,\"limits.ratio\":0.3333333333333333}",
+               text);
+    sarg_free_text(&data->root, text);
+}
+
+CTEST2(dump, json_double)
+{
+    const double vals[] = {0.1, 1e300, -2.5e-7, 0.1 + 0.2, 1.0 / 3.0};
+    const char *texts[] = {
+        "\"limits.ratio\":0.1}", "\"limits.ratio\":1e+300}",
+        "\"limits.ratio\":-2.5e-07}", "\"limits.ratio\":0.30000000000000004}",
+        "\"limits.ratio\":0.3333333333333333}"
+    };
+    sarg_result *res;
+    char *text;
+    int i, ret;
+
+    sarg_get(&data->root, "limits.ratio", &res);
+    for(i = 0; i < (int) (sizeof(vals) / sizeof(vals[0])); ++i) {
+        res->double_val = vals[i];
+        ret = sarg_dump_text(&data->root, SARG_DUMP_JSON, 0, &text);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+        ASSERT_STR(texts[i], strstr(text, "\"limits.ratio\""));
+        sarg_free_text(&data->root, text);
+    }
+
+#ifdef LC_NUMERIC
+    // the decimal point of the locale is not written
+    if(setlocale(LC_NUMERIC, "de_DE.UTF-8") != NULL) {
+        res->double_val = 0.5;
+        ret = sarg_dump_text(&data->root, SARG_DUMP_JSON, 0, &text);
+        setlocale(LC_NUMERIC, "C");
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+        ASSERT_NOT_NULL(strstr(text, "\"limits.ratio\":0.5}"));
+        sarg_free_text(&data->root, text);
+    }
+#endif
+}
+
+CTEST2(dump, json_escape)
+{
+    char value[6000];
+    char *text;
+    int ret;
+
+    // longer than the buffer of the writer
+    memset(value, 'a', sizeof(value));
+    value[0] = '\n';
+    value[1] = '\x01';
+    value[sizeof(value) - 1] = '\0';
+    ret = _sarg_parse_value(&data->copy, 1, value, strlen(value));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    data->copy.results[1].count = 1;
+
+    ret = sarg_dump_text(&data->copy, SARG_DUMP_JSON, 0, &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(sizeof(value) + 16, strlen(text));
+    ASSERT_TRUE(strncmp(text, "{\"name\":\"\\n\\u0001aaa", 20) == 0);
+    sarg_free_text(&data->copy, text);
+}
+
+CTEST2(dump, args)
+{
+    char *text;
+
+    int ret = sarg_dump_text(&data->root, SARG_DUMP_ARGS, 0, &text);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    // false BOOL options are left out
+    ASSERT_STR("verbose\nname my \"app\" \\\nserver.port 8080\n"
+               "limits.ratio 0.1\n", text);
+    sarg_free_text(&data->root, text);
+
+    ret = _sarg_parse_value(&data->root, 1, " padded", 7);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_dump_text(&data->root, SARG_DUMP_ARGS, 0, &text);
+    ASSERT_EQUAL(SARG_ERR_INVALARG, ret);
+    ASSERT_NULL(text);
+}
+
+#ifndef SARG_NO_FILE
+
+CTEST2(dump, args_file)
+{
+    sarg_result *res;
+
+    int ret = sarg_dump_file(&data->root, SARG_DUMP_ARGS, 0, "sarg_dump_test.txt");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ret = sarg_parse_file(&data->copy, "sarg_dump_test.txt");
+    remove("sarg_dump_test.txt");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->copy, "verbose", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->bool_val);
+    ret = sarg_get(&data->copy, "name", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("my \"app\" \\", res->str_val);
+    ret = sarg_get(&data->copy, "server.port", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(8080, res->uint_val);
+    ret = sarg_get(&data->copy, "limits.ratio", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_TRUE(res->double_val == 0.1);
+}
+
+#endif
+
+CTEST_TEARDOWN(dump)
+{
+    sarg_destroy(&data->root);
+    sarg_destroy(&data->copy);
+}
+
+#endif
+
+/* ==========================================================
+ * File Tests
+ * ========================================================== */
+
+#ifndef SARG_NO_FILE
+
+CTEST_DATA(file)
+{
+    sarg_root root;
+    char file1[32];
+    char file2[32];
+    char file3[32];
+};
+
+CTEST_SETUP(file)
+{
+    int ret;
+    sarg_opt args[] = {
+        {"n", "count", "some count variable", INT, NULL},
+        {NULL, "file", "out file", STRING, NULL},
+        {"q", NULL, "enable quiet mode", BOOL, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+
+    ret = sarg_init(&data->root, args, "test");
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    strcpy(data->file1, "test/test_args.txt");
+    strcpy(data->file2, "test/test_args_empty_lines.txt");
+    strcpy(data->file3, "test/test_args_untrimmed.txt");
+}
+
+CTEST2(file, parse_success)
+{
+    int ret;
+    sarg_result *res;
+
+    ret = sarg_parse_file(&data->root, data->file1);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
+
+    ret = sarg_get(&data->root, "n", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(15, res->int_val);
+
+    ret = sarg_get(&data->root, "q", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, res->count);
+    ASSERT_STR("foo", res->str_val);
+}
+
+CTEST2(file, parse_rules_deferred)
+{
+    const char *required[] = {"count", "out", NULL};
+    const char *argv[] = {"test", "--out", "x"};
+    sarg_opt args[] = {
+        {"n", "count", "some count variable", INT, NULL},
+        {NULL, "file", "out file", STRING, NULL},
+        {"q", NULL, "enable quiet mode", BOOL, NULL},
+        {NULL, "out", "output", STRING, NULL},
+        {NULL, NULL, NULL, INT, NULL}
+    };
+    sarg_root root;
+    int ret;
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&root, args, "test"));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_add_rule(&root, SARG_RULE_REQUIRED, required));
+
+    // the file lacks "out", which only the command line gives
+    ret = sarg_parse_file(&root, data->file1);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(SARG_ERR_MISSING, sarg_check(&root));
+
+    ret = sarg_parse(&root, argv, 3);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_check(&root));
+
+    sarg_destroy(&root);
+}
+
+CTEST2(file, parse_missing_value)
+{
+    sarg_result *res;
+
+    // the value of an option has to follow on the same line
+    int ret = sarg_parse_file(&data->root, "test/test_args_missing_value.txt");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    // offset of the option name on the third line
+    ASSERT_EQUAL(12, data->root.err_idx);
+
+    ret = sarg_get(&data->root, "count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(15, res->int_val);
+
+    ASSERT_EQUAL(SARG_ERR_ERRNO, sarg_parse_file(&data->root, "test/no_such_file.txt"));
+    ASSERT_EQUAL(-1, data->root.err_idx);
+}
+
+CTEST2(file, parse_extra_word)
+{
+    sarg_result *res;
+
+    // a flag takes no value, so the rest of its line is not dropped
+    int ret = sarg_parse_file(&data->root, "test/test_args_extra_word.txt");
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(11, data->root.err_idx);
+
+    ret = sarg_get(&data->root, "count", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(15, res->int_val);
+}
+
+CTEST2(file, parse_empty_lines)
+{
+    int ret;
+    sarg_result *res;
+
+    ret = sarg_parse_file(&data->root, data->file2);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
+
+    ret = sarg_get(&data->root, "n", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(15, res->int_val);
+
+    ret = sarg_get(&data->root, "q", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, res->count);
+    ASSERT_STR("foo", res->str_val);
+}
+
+CTEST2(file, parse_untrimmed)
+{
+    int ret;
+    sarg_result *res;
+
+    ret = sarg_parse_file(&data->root, data->file3);
+
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(data->root.opt_len, data->root.res_len);
+
+    ret = sarg_get(&data->root, "n", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(15, res->int_val);
+
+    ret = sarg_get(&data->root, "q", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(1, res->count);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, res->count);
+    ASSERT_STR("foo", res->str_val);
 }
 
 CTEST2(file, parse_overwrite)
@@ -673,9 +2685,111 @@ CTEST2(file, parse_overwrite)
     ASSERT_STR("foo", res->str_val);
 }
 
+CTEST2(file, parse_response)
+{
+    int ret;
+    sarg_result *res;
+    const char *argv[6] = {"", "-n", "3", "@test/test_response.txt", "-q", "-q"};
+
+    ret = sarg_parse(&data->root, argv, 6);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    // arguments of the file are inserted in place
+    ret = sarg_get(&data->root, "n", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, res->count);
+    ASSERT_EQUAL(15, res->int_val);
+
+    ret = sarg_get(&data->root, "q", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(3, res->count);
+    ASSERT_EQUAL(1, res->bool_val);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_STR("some file", res->str_val);
+}
+
+CTEST2(file, parse_response_nested)
+{
+    int ret;
+    sarg_result *res;
+    const char *argv[3] = {"", "@test/test_response_nested.txt", "-n"};
+
+    ret = sarg_parse(&data->root, argv, 2);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+
+    ret = sarg_get(&data->root, "file", &res);
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, ret);
+    ASSERT_EQUAL(2, res->count);
+    ASSERT_STR("bar", res->str_val);
+
+    // options must not take their value across a file boundary
+    argv[1] = "-n";
+    argv[2] = "@test/test_response.txt";
+    ret = sarg_parse(&data->root, argv, 3);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ASSERT_EQUAL(2, data->root.err_idx);
+}
+
+CTEST2(file, parse_response_fail)
+{
+    int ret;
+    const char *argv[2] = {"", "@test/test_response_cycle.txt"};
+
+    ret = sarg_parse(&data->root, argv, 2);
+    ASSERT_EQUAL(SARG_ERR_RECURSION, ret);
+    ASSERT_EQUAL(1, data->root.err_idx);
+
+    argv[1] = "@test/test_response_incomplete.txt";
+    ret = sarg_parse(&data->root, argv, 2);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+
+    argv[1] = "@test/does_not_exist.txt";
+    ret = sarg_parse(&data->root, argv, 2);
+    ASSERT_EQUAL(SARG_ERR_ERRNO, ret);
+}
+
 CTEST_TEARDOWN(file)
 {
     sarg_destroy(&data->root);
 }
 
 #endif
+
+CTEST(file, parse_files)
+{
+    sarg_root roots[24];
+    sarg_file_job jobs[24];
+    sarg_result *res;
+    int i;
+
+    for(i = 0; i < 24; ++i) {
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_init(&roots[i], test_args, "test"));
+        jobs[i].root = &roots[i];
+        jobs[i].filename = i % 2 ? "test/test_args.txt" : "test/test_args_untrimmed.txt";
+    }
+    jobs[7].filename = "test/does_not_exist.txt";
+
+    // each file has its own result and the first failure is returned
+    ASSERT_EQUAL(SARG_ERR_ERRNO, sarg_parse_files(jobs, 24, 4));
+    for(i = 0; i < 24; ++i) {
+        if(i == 7) {
+            ASSERT_EQUAL(SARG_ERR_ERRNO, jobs[i].ret);
+            continue;
+        }
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, jobs[i].ret);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&roots[i], "count", &res));
+        ASSERT_EQUAL(15, res->uint_val);
+        ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_get(&roots[i], "file", &res));
+        ASSERT_STR("foo", res->str_val);
+    }
+
+    jobs[7].filename = "test/test_args.txt";
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_files(&jobs[7], 1, 0));
+    ASSERT_EQUAL(SARG_ERR_SUCCESS, sarg_parse_files(jobs, 0, 0));
+    ASSERT_EQUAL(SARG_ERR_INVALARG, sarg_parse_files(NULL, 1, 0));
+
+    for(i = 0; i < 24; ++i)
+        sarg_destroy(&roots[i]);
+}
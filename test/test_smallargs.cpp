@@ -0,0 +1,69 @@
+/*
+ * test_smallargs.cpp
+ *
+ * Tests of the C++ wrapper in smallargs.hpp.
+ */
+
+#define CTEST_MAIN
+#define CTEST_SEGFAULT
+#define SARG_IMPLEMENTATION
+
+#include <smallargs.hpp>
+#include <ctest.h>
+
+int main(int argc, const char *argv[])
+{
+    return ctest_main(argc, argv);
+}
+
+/* ==========================================================
+ * Schema Tests
+ * ========================================================== */
+
+static int test_init_error(sarg::Root &root)
+{
+    try {
+        root.init();
+    } catch(sarg::Error &e) {
+        return e.errval();
+    }
+
+    return SARG_ERR_SUCCESS;
+}
+
+CTEST(schema, init_retry)
+{
+    sarg::Root root("test");
+
+    root.add("c", "count", "count up to this number", INT, NULL)
+        .add("m", "mode", "mode of operation", ENUM, NULL)
+        .setChoices("mode", {"fast", "slow"})
+        .setDefault("mode", "fast")
+        .setDefault("count", "abc");
+
+    // a failed init leaves the options and choices of the schema intact
+    int ret = test_init_error(root);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ret = test_init_error(root);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+    ret = test_init_error(root);
+    ASSERT_EQUAL(SARG_ERR_PARSE, ret);
+}
+
+CTEST(schema, clone)
+{
+    const char *argv[] = {"test", "-c", "3"};
+    sarg::Root root("test");
+
+    root.add("c", "count", "count up to this number", INT, NULL)
+        .add("m", "mode", "mode of operation", ENUM, NULL)
+        .setChoices("mode", {"fast", "slow"})
+        .setDefault("mode", "slow")
+        .init();
+
+    sarg::Root copy = root.clone();
+    copy.parse(argv, 3);
+    ASSERT_EQUAL(3, copy["count"].int_val);
+    ASSERT_EQUAL(1, copy["mode"].int_val);
+    ASSERT_EQUAL(0, root["count"].count);
+}
@@ -0,0 +1,753 @@
+/*
+ * sarg_gen.c
+ *
+ * Generates a C header from an option specification. The header holds
+ * a constant option table, a perfect hash lookup of the option names
+ * and the help text, so a static root can parse without any table built
+ * at runtime. Optionally a C++ header is generated as well, which holds
+ * a struct with one typed field per option and a parse function.
+ *
+ * The specification lists one option per line, written as arguments
+ * to the options of spec_opts below:
+ *
+ *     --program myapp
+ *     --short n --long count --type INT --text "some count variable"
+ *     --long dry-run --type BOOL --field dry
+ *
+ * Empty lines and lines starting with # are skipped.
+ */
+
+#include <smallargs.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_SEEDS 64
+#define GEN_MAX_BITS 20
+
+typedef struct _gen_opt {
+    char *short_name;
+    char *long_name;
+    char *help;
+    char *field;
+    sarg_opt_type type;
+} gen_opt;
+
+typedef struct _gen_spec {
+    char *program;
+    gen_opt *opts;
+    int opt_len;
+    // perfect hash of all names, see gen_hash_build
+    unsigned int seed;
+    int bits;
+    int *slots;
+} gen_spec;
+
+static sarg_opt gen_opts[] = {
+    {"i", "input", "option specification", STRING, NULL},
+    {"o", "output", "generated C header", STRING, NULL},
+    {"c", "cpp", "generated C++ header, optional", STRING, NULL},
+    {"p", "prefix", "prefix of all generated identifiers", STRING, NULL},
+    {"h", "help", "show help text", BOOL, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+static sarg_opt spec_opts[] = {
+    {NULL, "program", "program name used in the help text", STRING, NULL},
+    {NULL, "short", "short name of the option", STRING, NULL},
+    {NULL, "long", "long name of the option", STRING, NULL},
+    {NULL, "type", "type of the option", ENUM, NULL},
+    {NULL, "text", "help text of the option", STRING, NULL},
+    {NULL, "field", "name of the C++ field, defaults to the long name", STRING, NULL},
+    {NULL, NULL, NULL, INT, NULL}
+};
+
+/* ENUM options need a root, so they cannot be generated */
+static const char *spec_types[] = {
+    "INT", "UINT", "DOUBLE", "BOOL", "STRING", "SIZE", "DURATION", NULL
+};
+
+static const sarg_opt_type spec_type_ids[] = {
+    INT, UINT, DOUBLE, BOOL, STRING, SIZE, DURATION
+};
+
+static const char *cpp_types[COUNT] = {
+    "int", "unsigned int", "double", "bool", "std::string", NULL,
+    "uint64_t", "uint64_t"
+};
+
+static const char *cpp_values[COUNT] = {
+    "int_val", "uint_val", "double_val", "bool_val != 0", "str_val", NULL,
+    "size_val", "duration_val"
+};
+
+/* ==========================================================
+ * Specification
+ * ========================================================== */
+
+static char *gen_strdup(const char *str)
+{
+    char *copy;
+
+    if(!str)
+        return NULL;
+
+    copy = (char *) malloc(strlen(str) + 1);
+    if(copy)
+        strcpy(copy, str);
+
+    return copy;
+}
+
+static const char *gen_result_str(sarg_root *root, const char *name)
+{
+    sarg_result *res;
+
+    if(sarg_get(root, name, &res) != SARG_ERR_SUCCESS || res->count == 0)
+        return NULL;
+
+    return res->str_val;
+}
+
+static int gen_is_ident(const char *str)
+{
+    int i;
+
+    if(!str || !(isalpha((unsigned char) str[0]) || str[0] == '_'))
+        return 0;
+    for(i = 1; str[i] != '\0'; ++i) {
+        if(!isalnum((unsigned char) str[i]) && str[i] != '_')
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Adds the option of the current spec line. The field name defaults
+ * to the long name with dashes replaced by underscores.
+ */
+static int gen_add_opt(gen_spec *spec, sarg_root *root)
+{
+    gen_opt *opts, *opt;
+    sarg_result *type;
+    const char *field;
+    int i;
+
+    opts = (gen_opt *) realloc(spec->opts, sizeof(gen_opt) * (spec->opt_len + 1));
+    if(!opts)
+        return SARG_ERR_ALLOC;
+    spec->opts = opts;
+
+    opt = &opts[spec->opt_len];
+    memset(opt, 0, sizeof(gen_opt));
+    ++spec->opt_len;
+
+    sarg_get(root, "type", &type);
+    opt->type = spec_type_ids[type->int_val];
+    opt->short_name = gen_strdup(gen_result_str(root, "short"));
+    opt->long_name = gen_strdup(gen_result_str(root, "long"));
+    opt->help = gen_strdup(gen_result_str(root, "text"));
+
+    field = gen_result_str(root, "field");
+    if(!field)
+        field = opt->long_name ? opt->long_name : opt->short_name;
+    opt->field = gen_strdup(field);
+    if(!opt->field)
+        return SARG_ERR_ALLOC;
+    for(i = 0; opt->field[i] != '\0'; ++i) {
+        if(opt->field[i] == '-')
+            opt->field[i] = '_';
+    }
+    if(!gen_is_ident(opt->field))
+        return SARG_ERR_INVALARG;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/**
+ * Parses the specification in buf. Each line is handed to
+ * sarg_parse_string, so quoting works like on a command line.
+ */
+static int gen_read_spec(gen_spec *spec, const char *filename, char *buf)
+{
+    sarg_root root;
+    sarg_result *type;
+    char *line, *end;
+    int ret, lineno;
+
+    ret = sarg_init(&root, spec_opts, "spec");
+    if(ret != SARG_ERR_SUCCESS)
+        return ret;
+    ret = sarg_set_choices(&root, "type", spec_types);
+    if(ret != SARG_ERR_SUCCESS)
+        goto gen_read_spec_exit;
+
+    lineno = 0;
+    for(line = buf; line; line = end) {
+        ++lineno;
+        end = strchr(line, '\n');
+        if(end)
+            *end++ = '\0';
+
+        while(isspace((unsigned char) *line))
+            ++line;
+        if(line[0] == '\0' || line[0] == '#')
+            continue;
+
+        sarg_reset(&root);
+        ret = sarg_parse_string(&root, line);
+        if(ret != SARG_ERR_SUCCESS)
+            break;
+
+        if(gen_result_str(&root, "program")) {
+            free(spec->program);
+            spec->program = gen_strdup(gen_result_str(&root, "program"));
+            if(!spec->program) {
+                ret = SARG_ERR_ALLOC;
+                break;
+            }
+            continue;
+        }
+
+        // an option needs a type and at least one name
+        sarg_get(&root, "type", &type);
+        if(type->count == 0 || (!gen_result_str(&root, "short")
+                                && !gen_result_str(&root, "long"))) {
+            ret = SARG_ERR_MISSING;
+            break;
+        }
+
+        ret = gen_add_opt(spec, &root);
+        if(ret != SARG_ERR_SUCCESS)
+            break;
+    }
+
+    if(ret != SARG_ERR_SUCCESS)
+        fprintf(stderr, "%s:%d: %s\n", filename, lineno, sarg_strerror(ret));
+
+gen_read_spec_exit:
+    sarg_destroy(&root);
+    return ret;
+}
+
+static void gen_spec_destroy(gen_spec *spec)
+{
+    int i;
+
+    for(i = 0; i < spec->opt_len; ++i) {
+        free(spec->opts[i].short_name);
+        free(spec->opts[i].long_name);
+        free(spec->opts[i].help);
+        free(spec->opts[i].field);
+    }
+    free(spec->opts);
+    free(spec->program);
+    free(spec->slots);
+}
+
+/* ==========================================================
+ * Perfect hash
+ * ========================================================== */
+
+/* same FNV-1a hash and slot mapping as the generated lookup */
+static unsigned int gen_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for(; *name != '\0'; ++name) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+#define GEN_SLOT(hash, seed, bits) ((((hash) ^ (seed)) * 2654435761u) >> (32 - (bits)))
+
+static const char *gen_slot_name(const gen_spec *spec, const int slot)
+{
+    return (slot & 1) ? spec->opts[slot >> 1].long_name
+                      : spec->opts[slot >> 1].short_name;
+}
+
+/**
+ * Searches a seed for which all short and long names end up in
+ * different slots of a table with at least twice as many slots as
+ * names. Slots encode the option index and whether it is the long name.
+ *
+ * Names are told apart by their hash alone, so a duplicate name and two
+ * names with the same hash both fail with SARG_ERR_INVALARG. If no seed
+ * works up to GEN_MAX_BITS bits SARG_ERR_OTHER is returned.
+ */
+static int gen_hash_build(gen_spec *spec)
+{
+    unsigned int *hashes;
+    const char *name, *other;
+    int *names, *slots;
+    int i, j, len, pos, ret;
+
+    hashes = (unsigned int *) malloc(sizeof(unsigned int) * 2 * (spec->opt_len + 1));
+    names = (int *) malloc(sizeof(int) * 2 * (spec->opt_len + 1));
+    if(!hashes || !names) {
+        ret = SARG_ERR_ALLOC;
+        goto _gen_hash_build_exit;
+    }
+
+    len = 0;
+    for(i = 0; i < 2 * spec->opt_len; ++i) {
+        name = gen_slot_name(spec, i);
+        if(!name)
+            continue;
+        hashes[len] = gen_hash(name);
+        names[len] = i;
+        for(j = 0; j < len; ++j) {
+            if(hashes[j] != hashes[len])
+                continue;
+
+            other = gen_slot_name(spec, names[j]);
+            if(strcmp(name, other) == 0)
+                fprintf(stderr, "sarg_gen: duplicate option name %s\n", name);
+            else
+                fprintf(stderr, "sarg_gen: hash collision between option names"
+                        " %s and %s, rename one of them\n", other, name);
+            ret = SARG_ERR_INVALARG;
+            goto _gen_hash_build_exit;
+        }
+        ++len;
+    }
+
+    for(spec->bits = 1; (1 << spec->bits) < 2 * len; ++spec->bits);
+    for(; spec->bits <= GEN_MAX_BITS; ++spec->bits) {
+        slots = (int *) realloc(spec->slots, sizeof(int) << spec->bits);
+        if(!slots) {
+            ret = SARG_ERR_ALLOC;
+            goto _gen_hash_build_exit;
+        }
+        spec->slots = slots;
+
+        for(spec->seed = 0; spec->seed < GEN_SEEDS; ++spec->seed) {
+            memset(slots, -1, sizeof(int) << spec->bits);
+            for(i = 0; i < len; ++i) {
+                pos = GEN_SLOT(hashes[i], spec->seed, spec->bits);
+                if(slots[pos] >= 0)
+                    break;
+                slots[pos] = names[i];
+            }
+            if(i == len) {
+                ret = SARG_ERR_SUCCESS;
+                goto _gen_hash_build_exit;
+            }
+        }
+    }
+
+    fprintf(stderr, "sarg_gen: no perfect hash of %d option names found with"
+            " %d seeds and up to %d slots\n", len, GEN_SEEDS, 1 << GEN_MAX_BITS);
+    ret = SARG_ERR_OTHER;
+
+_gen_hash_build_exit:
+    free(hashes);
+    free(names);
+    return ret;
+}
+
+/* ==========================================================
+ * Output
+ * ========================================================== */
+
+static void gen_c_str(FILE *fp, const char *str, const int cast)
+{
+    if(!str) {
+        fputs("NULL", fp);
+        return;
+    }
+
+    if(cast)
+        fputs("(char *) ", fp);
+    fputc('"', fp);
+    for(; *str != '\0'; ++str) {
+        switch(*str) {
+        case '"':
+            fputs("\\\"", fp);
+            break;
+        case '\\':
+            fputs("\\\\", fp);
+            break;
+        case '\n':
+            // keep the lines of long strings apart
+            fputs(str[1] != '\0' ? "\\n\"\n    \"" : "\\n", fp);
+            break;
+        case '\t':
+            fputs("\\t", fp);
+            break;
+        default:
+            if((unsigned char) *str < 0x20)
+                fprintf(fp, "\\%03o", (unsigned char) *str);
+            else
+                fputc(*str, fp);
+            break;
+        }
+    }
+    fputc('"', fp);
+}
+
+static void gen_upper(FILE *fp, const char *str)
+{
+    for(; *str != '\0'; ++str)
+        fputc(toupper((unsigned char) *str), fp);
+}
+
+static const char *gen_basename(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+
+    return slash ? slash + 1 : path;
+}
+
+static int gen_write_c(const gen_spec *spec, const char *path, const char *p,
+                       const char *spec_path, const char *help)
+{
+    static const char *type_names[COUNT] = {
+        "INT", "UINT", "DOUBLE", "BOOL", "STRING", "ENUM", "SIZE", "DURATION"
+    };
+    FILE *fp;
+    int i;
+
+    fp = fopen(path, "w");
+    if(!fp)
+        return SARG_ERR_ERRNO;
+
+    fprintf(fp, "/* Generated by sarg_gen from %s, do not edit. */\n\n",
+            gen_basename(spec_path));
+    fputs("#ifndef ", fp); gen_upper(fp, p); fputs("_SARG_H_\n", fp);
+    fputs("#define ", fp); gen_upper(fp, p); fputs("_SARG_H_\n\n", fp);
+    fputs("#include <smallargs.h>\n#include <string.h>\n\n", fp);
+
+    fputs("#ifdef __GNUC__\n#define _", fp); gen_upper(fp, p);
+    fputs("_UNUSED __attribute__((unused))\n#else\n#define _", fp); gen_upper(fp, p);
+    fputs("_UNUSED\n#endif\n\n", fp);
+
+    fputs("#define ", fp); gen_upper(fp, p); fputs("_PROGRAM ", fp);
+    gen_c_str(fp, spec->program ? spec->program : p, 0);
+    fputs("\n\n/* indices of the options in the table and the results */\nenum {\n", fp);
+    for(i = 0; i < spec->opt_len; ++i) {
+        fputs("    ", fp); gen_upper(fp, p); fputc('_', fp);
+        gen_upper(fp, spec->opts[i].field);
+        fprintf(fp, " = %d,\n", i);
+    }
+    fputs("    ", fp); gen_upper(fp, p); fprintf(fp, "_OPT_LEN = %d\n};\n\n", spec->opt_len);
+
+    fprintf(fp, "static const sarg_opt %s_opts[] _", p); gen_upper(fp, p);
+    fputs("_UNUSED = {\n", fp);
+    // sarg_opt holds char pointers, the casts keep C++ quiet
+    for(i = 0; i < spec->opt_len; ++i) {
+        fputs("    {", fp);
+        gen_c_str(fp, spec->opts[i].short_name, 1);
+        fputs(", ", fp);
+        gen_c_str(fp, spec->opts[i].long_name, 1);
+        fputs(", ", fp);
+        gen_c_str(fp, spec->opts[i].help, 1);
+        fprintf(fp, ", %s, NULL},\n", type_names[spec->opts[i].type]);
+    }
+    fputs("    {NULL, NULL, NULL, INT, NULL}\n};\n\n", fp);
+
+    fprintf(fp, "static const char %s_help[] _", p); gen_upper(fp, p);
+    fputs("_UNUSED =\n    ", fp);
+    gen_c_str(fp, help, 0);
+    fputs(";\n\n", fp);
+
+    // names by slot of the perfect hash, -1 marks empty slots
+    fprintf(fp, "static const int %s_slots[%d] = {", p, 1 << spec->bits);
+    for(i = 0; i < (1 << spec->bits); ++i) {
+        fputs(i % 16 == 0 ? "\n    " : " ", fp);
+        fprintf(fp, "%d,", spec->slots[i] < 0 ? -1 : spec->slots[i] >> 1);
+    }
+    fprintf(fp, "\n};\n\nstatic const char *const %s_names[%d] = {", p, 1 << spec->bits);
+    for(i = 0; i < (1 << spec->bits); ++i) {
+        fputs("\n    ", fp);
+        gen_c_str(fp, spec->slots[i] < 0 ? NULL : gen_slot_name(spec, spec->slots[i]), 0);
+        fputc(',', fp);
+    }
+    fputs("\n};\n\n", fp);
+
+    fprintf(fp,
+            "/**\n"
+            " * Finds an option by its exact short or long name of length len\n"
+            " * with a perfect hash, see sarg_set_lookup.\n"
+            " */\n"
+            "static inline int %s_find(const char *name, const int len)\n"
+            "{\n"
+            "    unsigned int hash = 2166136261u;\n"
+            "    const char *opt_name;\n"
+            "    int i, pos;\n"
+            "\n"
+            "    for(i = 0; i < len; ++i) {\n"
+            "        hash ^= (unsigned char) name[i];\n"
+            "        hash *= 16777619u;\n"
+            "    }\n"
+            "\n"
+            "    pos = (int) (((hash ^ %uu) * 2654435761u) >> %d);\n"
+            "    opt_name = %s_names[pos];\n"
+            "    if(!opt_name || strlen(opt_name) != (size_t) len\n"
+            "       || memcmp(opt_name, name, len) != 0)\n"
+            "        return -1;\n"
+            "\n"
+            "    return %s_slots[pos];\n"
+            "}\n\n",
+            p, spec->seed, 32 - spec->bits, p, p);
+
+    fprintf(fp,
+            "/**\n"
+            " * Initializes a static root with the generated option table and\n"
+            " * lookup. Nothing is copied or built at runtime.\n"
+            " */\n"
+            "static inline int %s_init(sarg_root *root, const sarg_storage *storage)\n"
+            "{\n"
+            "    int ret;\n"
+            "\n"
+            "    ret = sarg_init_static(root, %s_opts, ", p, p);
+    gen_upper(fp, p);
+    fputs("_PROGRAM, storage);\n"
+          "    if(ret == SARG_ERR_SUCCESS)\n", fp);
+    fprintf(fp, "        sarg_set_lookup(root, %s_find);\n"
+            "\n"
+            "    return ret;\n"
+            "}\n\n#endif\n", p);
+
+    if(fclose(fp) != 0)
+        return SARG_ERR_ERRNO;
+
+    return SARG_ERR_SUCCESS;
+}
+
+static int gen_write_cpp(const gen_spec *spec, const char *path, const char *p,
+                         const char *spec_path, const char *c_path)
+{
+    FILE *fp;
+    int i;
+
+    fp = fopen(path, "w");
+    if(!fp)
+        return SARG_ERR_ERRNO;
+
+    fprintf(fp, "/* Generated by sarg_gen from %s, do not edit. */\n\n",
+            gen_basename(spec_path));
+    fputs("#ifndef ", fp); gen_upper(fp, p); fputs("_SARG_HPP_\n", fp);
+    fputs("#define ", fp); gen_upper(fp, p); fputs("_SARG_HPP_\n\n", fp);
+    fprintf(fp, "#include <cstring>\n#include <stdint.h>\n#include <string>\n"
+            "#include <vector>\n#include <smallargs.hpp>\n#include \"%s\"\n\n",
+            gen_basename(c_path));
+
+    fprintf(fp, "/**\n * Typed values of all options. Options that do not appear keep\n"
+            " * their values.\n */\nstruct %s_args\n{\n", p);
+    for(i = 0; i < spec->opt_len; ++i) {
+        fprintf(fp, "    %s %s;\n", cpp_types[spec->opts[i].type], spec->opts[i].field);
+    }
+    fputs("    // number of appearances by option index\n", fp);
+    fputs("    int counts[", fp); gen_upper(fp, p); fputs("_OPT_LEN];\n\n", fp);
+
+    fprintf(fp, "    %s_args()\n    :", p);
+    for(i = 0; i < spec->opt_len; ++i)
+        fprintf(fp, "%s()%s", spec->opts[i].field, i % 4 == 3 ? ",\n    " : ", ");
+    fputs("counts()\n    {}\n\n", fp);
+
+    fputs("    /**\n"
+          "     * Parses the given arguments with a static root, which uses the\n"
+          "     * generated option table and lookup, and stores the results in\n"
+          "     * the fields.\n"
+          "     */\n"
+          "    sarg::Status parse(const char **argv, const int argc)\n"
+          "    {\n", fp);
+    fputs("        sarg_result results[", fp); gen_upper(fp, p);
+    fputs("_OPT_LEN > 0 ? ", fp); gen_upper(fp, p); fputs("_OPT_LEN : 1];\n", fp);
+    fputs("        std::vector<char> strings(1);\n"
+          "        sarg_storage storage;\n"
+          "        sarg_root root;\n"
+          "        int i, ret;\n"
+          "\n"
+          "        // string values fit into the length of all arguments\n"
+          "        for(i = 0; i < argc; ++i)\n"
+          "            strings.resize(strings.size() + std::strlen(argv[i]) + 1);\n"
+          "\n"
+          "        std::memset(&storage, 0, sizeof(storage));\n"
+          "        storage.results = results;\n", fp);
+    fputs("        storage.res_len = ", fp); gen_upper(fp, p); fputs("_OPT_LEN;\n", fp);
+    fprintf(fp,
+          "        storage.str_buf = strings.data();\n"
+          "        storage.str_len = (int) strings.size();\n"
+          "\n"
+          "        ret = %s_init(&root, &storage);\n"
+          "        if(ret == SARG_ERR_SUCCESS)\n"
+          "            ret = sarg_parse(&root, argv, argc);\n"
+          "        if(ret != SARG_ERR_SUCCESS) {\n"
+          "            i = root.err_idx;\n"
+          "            sarg_destroy(&root);\n"
+          "            return sarg::Status(ret, i, i >= 0 && i < argc ? argv[i] : NULL);\n"
+          "        }\n"
+          "\n", p);
+
+    for(i = 0; i < spec->opt_len; ++i) {
+        fprintf(fp, "        if(results[%d].count > 0)\n", i);
+        if(spec->opts[i].type == STRING)
+            fprintf(fp, "            %s = results[%d].str_val ? results[%d].str_val : \"\";\n",
+                    spec->opts[i].field, i, i);
+        else
+            fprintf(fp, "            %s = results[%d].%s;\n", spec->opts[i].field, i,
+                    cpp_values[spec->opts[i].type]);
+    }
+    fputs("        for(i = 0; i < ", fp); gen_upper(fp, p);
+    fputs("_OPT_LEN; ++i)\n"
+          "            counts[i] += results[i].count;\n"
+          "\n"
+          "        sarg_destroy(&root);\n"
+          "        return sarg::Status();\n"
+          "    }\n"
+          "};\n\n#endif\n", fp);
+
+    if(fclose(fp) != 0)
+        return SARG_ERR_ERRNO;
+
+    return SARG_ERR_SUCCESS;
+}
+
+/* ==========================================================
+ * Main
+ * ========================================================== */
+
+static char *gen_read_file(const char *filename)
+{
+    char *buf;
+    long len;
+    FILE *fp;
+
+    fp = fopen(filename, "rb");
+    if(!fp)
+        return NULL;
+
+    buf = NULL;
+    if(fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) >= 0
+       && fseek(fp, 0, SEEK_SET) == 0) {
+        buf = (char *) malloc(len + 1);
+        if(buf && fread(buf, 1, len, fp) != (size_t) len) {
+            free(buf);
+            buf = NULL;
+        }
+        if(buf)
+            buf[len] = '\0';
+    }
+    fclose(fp);
+
+    return buf;
+}
+
+/**
+ * Builds the help text of the specified options at generation time.
+ */
+static int gen_help_text(const gen_spec *spec, const char *prefix, char **help)
+{
+    sarg_opt *opts;
+    sarg_root root;
+    char *text;
+    int i, ret;
+
+    *help = NULL;
+    opts = (sarg_opt *) calloc(spec->opt_len + 1, sizeof(sarg_opt));
+    if(!opts)
+        return SARG_ERR_ALLOC;
+    for(i = 0; i < spec->opt_len; ++i) {
+        opts[i].short_name = spec->opts[i].short_name;
+        opts[i].long_name = spec->opts[i].long_name;
+        opts[i].help = spec->opts[i].help;
+        opts[i].type = spec->opts[i].type;
+    }
+
+    ret = sarg_init(&root, opts, spec->program ? spec->program : prefix);
+    if(ret == SARG_ERR_SUCCESS) {
+        // the text belongs to the root, keep a copy that outlives it
+        ret = sarg_help_text(&root, &text);
+        if(ret == SARG_ERR_SUCCESS) {
+            *help = gen_strdup(text);
+            if(!*help)
+                ret = SARG_ERR_ALLOC;
+            sarg_free_text(&root, text);
+        }
+        sarg_destroy(&root);
+    }
+    free(opts);
+
+    return ret;
+}
+
+int main(int argc, const char **argv)
+{
+    const char *required[] = {"input", "output", "prefix", NULL};
+    const char *input, *output, *cpp, *prefix;
+    sarg_root root;
+    sarg_result *res;
+    gen_spec spec;
+    char *buf, *help;
+    int ret;
+
+    ret = sarg_init(&root, gen_opts, "sarg_gen");
+    if(ret != SARG_ERR_SUCCESS) {
+        fprintf(stderr, "%s\n", sarg_strerror(ret));
+        return 1;
+    }
+
+    ret = sarg_add_rule(&root, SARG_RULE_REQUIRED, required);
+    if(ret == SARG_ERR_SUCCESS)
+        ret = sarg_parse(&root, argv, argc);
+    sarg_get(&root, "help", &res);
+    if(res->bool_val) {
+        sarg_help_print(&root);
+        sarg_destroy(&root);
+        return 0;
+    }
+    if(ret == SARG_ERR_SUCCESS)
+        ret = sarg_check(&root);
+    if(ret != SARG_ERR_SUCCESS) {
+        fprintf(stderr, "sarg_gen: %s\n", sarg_strerror(ret));
+        sarg_help_print(&root);
+        sarg_destroy(&root);
+        return 1;
+    }
+
+    input = gen_result_str(&root, "input");
+    output = gen_result_str(&root, "output");
+    cpp = gen_result_str(&root, "cpp");
+    prefix = gen_result_str(&root, "prefix");
+
+    memset(&spec, 0, sizeof(spec));
+    help = NULL;
+    buf = gen_read_file(input);
+    if(!buf) {
+        perror(input);
+        ret = SARG_ERR_ERRNO;
+    } else if(!gen_is_ident(prefix)) {
+        fprintf(stderr, "sarg_gen: prefix %s is no identifier\n", prefix);
+        ret = SARG_ERR_INVALARG;
+    } else {
+        ret = gen_read_spec(&spec, input, buf);
+    }
+
+    if(ret == SARG_ERR_SUCCESS)
+        ret = gen_hash_build(&spec);
+    if(ret == SARG_ERR_SUCCESS)
+        ret = gen_help_text(&spec, prefix, &help);
+    if(ret == SARG_ERR_SUCCESS)
+        ret = gen_write_c(&spec, output, prefix, input, help);
+    if(ret == SARG_ERR_SUCCESS && cpp)
+        ret = gen_write_cpp(&spec, cpp, prefix, input, output);
+    if(ret == SARG_ERR_ERRNO)
+        perror("sarg_gen");
+    else if(ret != SARG_ERR_SUCCESS)
+        fprintf(stderr, "sarg_gen: %s\n", sarg_strerror(ret));
+
+    free(help);
+    free(buf);
+    gen_spec_destroy(&spec);
+    sarg_destroy(&root);
+
+    return ret == SARG_ERR_SUCCESS ? 0 : 1;
+}